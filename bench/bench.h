@@ -0,0 +1,18 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Shared helpers for the headless benchmark executables (make bench).
+// Everything here is single threaded and deterministic: same inputs,
+// same numbers, so results can be diffed across commits.
+
+uint64_t bench_now_ns();
+int bench_cmp_u64(const void* a, const void* b);
+uint64_t bench_percentile(uint64_t* sorted, size_t count, double pct);
+uint64_t bench_fnv1a(uint64_t hash, const void* data, size_t size);
+void bench_setup_world(uint8_t render_distance);
+void bench_teardown_world();
+
+#endif
@@ -0,0 +1,56 @@
+#include "main.h"
+#include "config.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Globals normally provided by the windowed translation units.
+config settings;
+chunk_slot_t*** chunks = NULL;
+_Atomic bool mesh_needs_rebuild = false;
+
+uint64_t bench_now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+int bench_cmp_u64(const void* a, const void* b) {
+	uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+	return (x > y) - (x < y);
+}
+
+uint64_t bench_percentile(uint64_t* sorted, size_t count, double pct) {
+	if (count == 0) return 0;
+	size_t idx = (size_t)(pct / 100.0 * (double)(count - 1) + 0.5);
+	if (idx >= count) idx = count - 1;
+	return sorted[idx];
+}
+
+uint64_t bench_fnv1a(uint64_t hash, const void* data, size_t size) {
+	const uint8_t* p = data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= p[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+void bench_setup_world(uint8_t render_distance) {
+	memset(&settings, 0, sizeof(settings));
+	settings.render_distance = render_distance;
+	settings.fancy_graphics = true;
+	chunks = allocate_chunks();
+	if (!chunks) {
+		fprintf(stderr, "Failed to allocate chunk grid\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void bench_teardown_world() {
+	if (!chunks) return;
+	free_chunks(chunks);
+	chunks = NULL;
+}
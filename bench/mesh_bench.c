@@ -0,0 +1,282 @@
+#include "main.h"
+#include "config.h"
+#include "stb_perlin.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Meshes the centre chunk of canned 3x3 column neighbourhoods with
+// snapshot_chunk + generate_chunk_mesh and reports quads, allocation traffic
+// and ns/chunk.
+// The hash of every emitted mesh can be written out (-o) and checked
+// against a previous run (-c) to prove an optimisation is byte-identical.
+
+#define FIXTURE_GRID 3
+#define FIXTURE_CY   4
+
+// Allocation accounting: the mesh objects are linked with
+// -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc so every request lands here.
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+static uint64_t alloc_bytes = 0;
+static uint64_t alloc_calls = 0;
+
+void* __wrap_malloc(size_t size) {
+	alloc_bytes += size;
+	alloc_calls++;
+	return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+	alloc_bytes += count * size;
+	alloc_calls++;
+	return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+	alloc_bytes += size;
+	alloc_calls++;
+	return __real_realloc(ptr, size);
+}
+
+typedef uint8_t (*fixture_fn)(int wx, int wy, int wz);
+
+static uint8_t fixture_flat(int wx, int wy, int wz) {
+	(void)wx; (void)wz;
+	if (wy > 70) return 0;
+	if (wy == 70) return 2;
+	if (wy >= 67) return 1;
+	return 3;
+}
+
+static uint8_t fixture_caves(int wx, int wy, int wz) {
+	if (wy > 78) return 0;
+	float n = stb_perlin_noise3(wx * 0.12f, wy * 0.12f, wz * 0.12f, 0, 0, 0);
+	if (n > 0.15f) return 0;
+	return (wx * 7 + wy * 13 + wz * 3) % 29 == 0 ? 16 : 3;
+}
+
+static uint8_t fixture_forest(int wx, int wy, int wz) {
+	if (wy < 67) return wy == 66 ? 2 : 1;
+	int gx = ((wx % 7) + 7) % 7, gz = ((wz % 7) + 7) % 7;
+	for (int i = 0; i < tree_structure.block_count; i++) {
+		structure_block_t* b = &tree_structure.blocks[i];
+		if (gx == 3 + b->x && wy == 67 + b->y && gz == 3 + b->z)
+			return b->block_id;
+	}
+	if (wy == 67 && (wx * 5 + wz * 3) % 11 == 0) return 37 + ((wx + wz) & 1);
+	return 0;
+}
+
+static uint8_t fixture_ocean(int wx, int wy, int wz) {
+	float n = stb_perlin_noise3(wx * 0.07f, 0.f, wz * 0.07f, 0, 0, 0);
+	int floor_y = 64 + (int)(n * 8.f);
+	if (wy <= floor_y) return 12;
+	if (wy <= 74) return 9;
+	return 0;
+}
+
+static uint8_t fixture_checkerboard(int wx, int wy, int wz) {
+	return ((wx + wy + wz) & 1) ? 3 : 0;
+}
+
+typedef struct {
+	const char* name;
+	fixture_fn fn;
+} fixture_t;
+
+static const fixture_t fixtures[] = {
+	{ "flat",         fixture_flat },
+	{ "caves",        fixture_caves },
+	{ "forest",       fixture_forest },
+	{ "ocean",        fixture_ocean },
+	{ "checkerboard", fixture_checkerboard },
+};
+#define FIXTURE_COUNT (int)(sizeof(fixtures) / sizeof(fixtures[0]))
+
+static void build_fixture(const fixture_t* f, Chunk* column) {
+	for (int gx = 0; gx < FIXTURE_GRID; gx++) {
+		for (int gz = 0; gz < FIXTURE_GRID; gz++) {
+			memset(column, 0, WORLD_HEIGHT * sizeof(Chunk));
+			for (int cy = 0; cy < WORLD_HEIGHT; cy++) {
+				Chunk* c = &column[cy];
+				for (int x = 0; x < CHUNK_SIZE; x++)
+					for (int y = 0; y < CHUNK_SIZE; y++)
+						for (int z = 0; z < CHUNK_SIZE; z++) {
+							uint8_t id = f->fn(gx * CHUNK_SIZE + x, cy * CHUNK_SIZE + y, gz * CHUNK_SIZE + z);
+							if (id) chunk_set_id(c, x, y, z, id);
+						}
+				chunk_update_summary(c);
+			}
+			init_column_lighting(column, NULL);
+
+			for (int cy = 0; cy < WORLD_HEIGHT; cy++) {
+				Chunk* slot = chunks[gx][cy][gz];
+				unload_chunk(slot);
+				*slot = column[cy];
+				slot->ci_x = gx; slot->ci_y = cy; slot->ci_z = gz;
+				slot->x = gx;    slot->y = cy;    slot->z = gz;
+				slot->is_loaded = true;
+			}
+		}
+	}
+}
+
+static uint64_t hash_mesh(const Chunk* c) {
+	uint64_t h = 0xcbf29ce484222325ull;
+	for (int pass = 0; pass < 2; pass++) {
+		for (int f = 0; f < 6; f++) {
+			const mesh_range_t* r = &c->mesh.faces[pass][f];
+			h = bench_fnv1a(h, &r->vertex_count, sizeof(r->vertex_count));
+			if (!r->vertex_count) continue;
+			if (c->mesh.records[pass])
+				h = bench_fnv1a(h, &c->mesh.records[pass][r->first_vertex / 4], r->vertex_count / 4 * sizeof(quad_record_t));
+			else
+				h = bench_fnv1a(h, &c->mesh.vertices[pass][r->first_vertex], r->vertex_count * sizeof(Vertex));
+		}
+	}
+	return h;
+}
+
+static void count_quads(const Chunk* c, uint32_t* opaque, uint32_t* transparent) {
+	*opaque      = c->mesh.vertex_count[0] / 4;
+	*transparent = c->mesh.vertex_count[1] / 4;
+}
+
+static void usage(const char* name) {
+	fprintf(stderr, "Usage: %s [-n iterations] [-q] [-o hashes_out] [-c hashes_in]\n", name);
+	fprintf(stderr, "  -n  meshing iterations per fixture (default 200)\n");
+	fprintf(stderr, "  -q  mesh into quad records (quad_pulling), which hash differently\n");
+	fprintf(stderr, "  -o  write per-fixture mesh hashes to a file\n");
+	fprintf(stderr, "  -c  compare mesh hashes against a file written by -o\n");
+}
+
+int main(int argc, char** argv) {
+	int iterations = 200;
+	const char* out_path = NULL;
+	const char* check_path = NULL;
+	bool quad_records = false;
+	int opt;
+	while ((opt = getopt(argc, argv, "n:qo:c:h")) != -1) {
+		switch (opt) {
+			case 'n': iterations = atoi(optarg); break;
+			case 'q': quad_records = true; break;
+			case 'o': out_path   = optarg; break;
+			case 'c': check_path = optarg; break;
+			default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (iterations <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	bench_setup_world(FIXTURE_GRID);
+	settings.quad_pulling = quad_records;
+
+	// One scratch for the whole run, like a mesh worker.
+	mesh_scratch_t scratch;
+	if (!mesh_scratch_init(&scratch)) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	Chunk* column = chunk_column_acquire();
+	uint64_t* samples = malloc(iterations * sizeof(uint64_t));
+	uint64_t hashes[FIXTURE_COUNT];
+	if (!column || !samples) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	printf("Meshing benchmark (%d iterations per fixture, %s)\n", iterations, quad_records ? "quad records" : "vertices");
+	printf("  %-13s %8s %8s %11s %11s %13s %9s %9s  %s\n",
+	       "fixture", "opaque", "trans", "ns/chunk", "p99 ns", "alloc B/chunk", "allocs", "mesh B", "hash");
+
+	for (int fi = 0; fi < FIXTURE_COUNT; fi++) {
+		build_fixture(&fixtures[fi], column);
+		Chunk* target = chunks[FIXTURE_GRID / 2][FIXTURE_CY][FIXTURE_GRID / 2];
+
+		uint64_t bytes_before = alloc_bytes, calls_before = alloc_calls;
+		uint64_t total_ns = 0;
+		for (int i = 0; i < iterations; i++) {
+			target->needs_update = true;
+			uint64_t t0 = bench_now_ns();
+			snapshot_chunk(target, &scratch.snapshot);
+			chunk_mesh_t mesh;
+			generate_chunk_mesh(&scratch, &mesh);
+			chunk_mesh_free(&target->mesh);
+			target->mesh = mesh;
+			samples[i] = bench_now_ns() - t0;
+			total_ns += samples[i];
+		}
+		uint64_t bytes = (alloc_bytes - bytes_before) / iterations;
+		uint64_t calls = (alloc_calls - calls_before) / iterations;
+		qsort(samples, iterations, sizeof(uint64_t), bench_cmp_u64);
+
+		uint32_t quads_o, quads_t;
+		count_quads(target, &quads_o, &quads_t);
+		hashes[fi] = hash_mesh(target);
+		// What an upload sends.
+		size_t mesh_bytes = (quads_o + quads_t) * (quad_records ? sizeof(quad_record_t) : 4 * sizeof(Vertex));
+
+		printf("  %-13s %8u %8u %11llu %11llu %13llu %9llu %9zu  %016llx\n",
+		       fixtures[fi].name, quads_o, quads_t,
+		       (unsigned long long)(total_ns / iterations),
+		       (unsigned long long)bench_percentile(samples, iterations, 99.0),
+		       (unsigned long long)bytes, (unsigned long long)calls,
+		       mesh_bytes, (unsigned long long)hashes[fi]);
+	}
+
+	int status = 0;
+	if (out_path) {
+		FILE* f = fopen(out_path, "w");
+		if (!f) {
+			perror("fopen");
+			status = 1;
+		} else {
+			for (int fi = 0; fi < FIXTURE_COUNT; fi++)
+				fprintf(f, "%s %016llx\n", fixtures[fi].name, (unsigned long long)hashes[fi]);
+			fclose(f);
+		}
+	}
+
+	if (check_path) {
+		FILE* f = fopen(check_path, "r");
+		if (!f) {
+			perror("fopen");
+			status = 1;
+		} else {
+			char name[64];
+			unsigned long long expected;
+			int matched = 0;
+			while (fscanf(f, "%63s %llx", name, &expected) == 2) {
+				for (int fi = 0; fi < FIXTURE_COUNT; fi++) {
+					if (strcmp(name, fixtures[fi].name) != 0) continue;
+					matched++;
+					if (hashes[fi] != expected) {
+						printf("MISMATCH %s: expected %016llx, got %016llx\n",
+						       name, expected, (unsigned long long)hashes[fi]);
+						status = 1;
+					}
+				}
+			}
+			fclose(f);
+			if (matched != FIXTURE_COUNT) {
+				printf("Hash file covers %d of %d fixtures\n", matched, FIXTURE_COUNT);
+				status = 1;
+			}
+			if (!status) printf("All mesh hashes match %s\n", check_path);
+		}
+	}
+
+	mesh_scratch_free(&scratch);
+	free(samples);
+	free(column);  // its chunks' storage was moved into the grid
+	bench_teardown_world();
+	return status;
+}
@@ -0,0 +1,252 @@
+#include "main.h"
+#include "bench.h"
+#include "stb_perlin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Drives the same per-column pipeline as world_gen_thread_func (column
+// context, terrain for every chunk in the column, then the column sky/emitter
+// lighting pass) over a fixed grid of columns and reports throughput, latency
+// and stage split.
+// The batched noise the terrain uses is hashed against the scalar calls on
+// every run, so whichever SIMD path the build picked (AVX2, SSE2, NEON) is
+// checked on the machine that runs it.
+// With -d the grid is also saved to region files there and read back, to
+// compare loading a column from disk against generating it.
+
+enum { STAGE_TERRAIN, STAGE_LIGHTING, STAGE_COUNT };
+static const char* stage_names[STAGE_COUNT] = { "terrain", "lighting" };
+
+static uint64_t column_checksum(uint64_t checksum, const Chunk* column) {
+	for (int cy = 0; cy < WORLD_HEIGHT; cy++) {
+		Block blocks[CHUNK_SIZE][CHUNK_SIZE][CHUNK_SIZE];
+		for (int x = 0; x < CHUNK_SIZE; x++)
+			for (int y = 0; y < CHUNK_SIZE; y++)
+				for (int z = 0; z < CHUNK_SIZE; z++)
+					blocks[x][y][z] = chunk_get_block(&column[cy], x, y, z);
+		checksum = bench_fnv1a(checksum, blocks, sizeof(blocks));
+	}
+	return checksum;
+}
+
+// Hashes batched and scalar noise over the same points, spread across both
+// signs and several lattice periods. Returns true when every output matches.
+#define NOISE_CHECK_POINTS 4096
+static bool noise_check(uint64_t* batch_hash, uint64_t* scalar_hash) {
+	static float x[NOISE_CHECK_POINTS], y[NOISE_CHECK_POINTS], z[NOISE_CHECK_POINTS];
+	static float batch[NOISE_CHECK_POINTS], scalar[NOISE_CHECK_POINTS];
+	uint32_t state = 0x9e3779b9u;
+	for (int i = 0; i < NOISE_CHECK_POINTS; i++) {
+		state = state * 1664525u + 1013904223u; x[i] = (int32_t)state / 65536.f * 0.37f;
+		state = state * 1664525u + 1013904223u; y[i] = (int32_t)state / 65536.f * 0.11f;
+		state = state * 1664525u + 1013904223u; z[i] = (int32_t)state / 65536.f * 0.37f;
+	}
+
+	*batch_hash = *scalar_hash = 0xcbf29ce484222325ull;
+	for (int kind = 0; kind < 3; kind++) {
+		// An odd count also runs the scalar tail of each batch.
+		int n = NOISE_CHECK_POINTS - 3;
+		if (kind == 0) perlin_noise2_batch(x, z, batch, n);
+		if (kind == 1) perlin_noise3_batch(x, y, z, batch, n);
+		if (kind == 2) perlin_fbm_noise3_batch(x, y, z, batch, n, 2.f, 0.5f, 2);
+		for (int i = 0; i < n; i++) {
+			if (kind == 0) scalar[i] = stb_perlin_noise3(x[i], 0.f, z[i], 0, 0, 0);
+			if (kind == 1) scalar[i] = stb_perlin_noise3(x[i], y[i], z[i], 0, 0, 0);
+			if (kind == 2) scalar[i] = stb_perlin_fbm_noise3(x[i], y[i], z[i], 2.f, 0.5f, 2);
+		}
+		*batch_hash  = bench_fnv1a(*batch_hash, batch, n * sizeof(float));
+		*scalar_hash = bench_fnv1a(*scalar_hash, scalar, n * sizeof(float));
+	}
+	return *batch_hash == *scalar_hash;
+}
+
+// Round-trips the region file RLE over inputs shaped to defeat it: single
+// bytes between pairs, bare pairs, alternations and runs just past the
+// longest run record. Output must stay within REGION_RLE_BOUND and must not
+// touch the guard bytes after it.
+#define RLE_CHECK_SIZE 3000
+#define RLE_CHECK_GUARD 64
+static bool rle_check() {
+	static uint8_t in[RLE_CHECK_SIZE], out[RLE_CHECK_SIZE];
+	static uint8_t encoded[REGION_RLE_BOUND(RLE_CHECK_SIZE) + RLE_CHECK_GUARD];
+	uint32_t state = 12345;
+	for (int pattern = 0; pattern < 6; pattern++) {
+		for (int i = 0; i < RLE_CHECK_SIZE; i++) {
+			switch (pattern) {
+				case 0: in[i] = (uint8_t)((i / 3) * 2 + (i % 3 != 0)); break;  // a bb c dd ...
+				case 1: in[i] = (uint8_t)(i / 2); break;                        // aa bb cc ...
+				case 2: in[i] = (uint8_t)(i & 1); break;                        // abab ...
+				case 3: in[i] = (uint8_t)(i / 3 + (i % 4 == 0) * 7); break;     // runs broken by singles
+				case 4: in[i] = (uint8_t)(i / 130); break;                      // runs of 130
+				case 5: state = state * 1664525u + 1013904223u; in[i] = (uint8_t)(state >> 24); break;
+			}
+		}
+		memset(encoded, 0xA5, sizeof(encoded));
+		size_t n = region_rle_encode(in, RLE_CHECK_SIZE, encoded);
+		for (int g = 0; g < RLE_CHECK_GUARD; g++)
+			if (encoded[REGION_RLE_BOUND(RLE_CHECK_SIZE) + g] != 0xA5) return false;
+		if (n > REGION_RLE_BOUND(RLE_CHECK_SIZE)) return false;
+		if (!region_rle_decode(encoded, n, out, RLE_CHECK_SIZE) || memcmp(in, out, RLE_CHECK_SIZE) != 0)
+			return false;
+	}
+	return true;
+}
+
+static void usage(const char* name) {
+	fprintf(stderr, "Usage: %s [-g grid] [-x origin_x] [-z origin_z] [-r passes] [-d dir]\n", name);
+	fprintf(stderr, "  -g  columns per side of the generated grid (default 8)\n");
+	fprintf(stderr, "  -x  chunk x coordinate of the grid origin (default 0)\n");
+	fprintf(stderr, "  -z  chunk z coordinate of the grid origin (default 0)\n");
+	fprintf(stderr, "  -r  number of passes over the grid (default 1)\n");
+	fprintf(stderr, "  -d  directory to save and reload the grid's region files in\n");
+}
+
+int main(int argc, char** argv) {
+	int grid = 8, origin_x = 0, origin_z = 0, passes = 1;
+	const char* save_dir = NULL;
+	int opt;
+	while ((opt = getopt(argc, argv, "g:x:z:r:d:h")) != -1) {
+		switch (opt) {
+			case 'g': grid     = atoi(optarg); break;
+			case 'x': origin_x = atoi(optarg); break;
+			case 'z': origin_z = atoi(optarg); break;
+			case 'r': passes   = atoi(optarg); break;
+			case 'd': save_dir = optarg; break;
+			default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (grid <= 0 || passes <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	bench_setup_world(1);
+	if (save_dir && !region_init(save_dir))
+		return 1;
+
+	size_t total_columns = (size_t)grid * grid * passes;
+	uint64_t* column_ns = malloc(total_columns * sizeof(uint64_t));
+	Chunk* column = chunk_column_acquire();
+	if (!column_ns || !column) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	uint64_t stage_ns[STAGE_COUNT] = {0};
+	uint64_t checksum = 0xcbf29ce484222325ull;
+	size_t n = 0;
+	size_t storage_bytes = 0, uniform_chunks = 0, empty_chunks = 0, solid_chunks = 0;
+	size_t opaque_face_chunks = 0;
+	memset(column, 0, WORLD_HEIGHT * sizeof(Chunk));
+
+	for (int pass = 0; pass < passes; pass++) {
+		for (int gx = 0; gx < grid; gx++) {
+			for (int gz = 0; gz < grid; gz++) {
+				int cx = origin_x + gx;
+				int cz = origin_z + gz;
+				for (int cy = 0; cy < WORLD_HEIGHT; cy++)
+					chunk_free_storage(&column[cy]);
+				memset(column, 0, WORLD_HEIGHT * sizeof(Chunk));
+
+				uint64_t t0 = bench_now_ns();
+				column_context_t ctx;
+				generate_column_context(&ctx, cx, cz);
+				for (int cy = 0; cy < WORLD_HEIGHT; cy++)
+					load_chunk_data(&column[cy], &ctx, 0, cy, 0, cy);
+				uint64_t t1 = bench_now_ns();
+				init_column_lighting(column, &ctx);
+				release_column_context(&ctx);
+				uint64_t t2 = bench_now_ns();
+
+				stage_ns[STAGE_TERRAIN]  += t1 - t0;
+				stage_ns[STAGE_LIGHTING] += t2 - t1;
+				column_ns[n++] = t2 - t0;
+
+				// Only the first pass feeds the checksum so it stays
+				// comparable between runs with a different -r.
+				if (pass == 0) {
+					checksum = column_checksum(checksum, column);
+					for (int cy = 0; cy < WORLD_HEIGHT; cy++) {
+						storage_bytes += chunk_storage_bytes(&column[cy]);
+						if (!column[cy].palette_bits) uniform_chunks++;
+						if (!column[cy].summary.block_count) empty_chunks++;
+						if (column[cy].summary.cube_count == CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE) solid_chunks++;
+						if (column[cy].summary.opaque_faces) opaque_face_chunks++;
+					}
+					if (save_dir) {
+						Chunk* chunks_in_column[WORLD_HEIGHT];
+						for (int cy = 0; cy < WORLD_HEIGHT; cy++)
+							chunks_in_column[cy] = &column[cy];
+						region_save_column(chunks_in_column);
+					}
+				}
+			}
+		}
+	}
+
+	uint64_t busy_ns = 0;
+	for (int s = 0; s < STAGE_COUNT; s++) busy_ns += stage_ns[s];
+	qsort(column_ns, n, sizeof(uint64_t), bench_cmp_u64);
+
+	printf("World generation benchmark\n");
+	printf("  grid:       %dx%d columns at chunk (%d, %d), %d pass(es)\n", grid, grid, origin_x, origin_z, passes);
+	printf("  columns:    %zu (%d chunks each)\n", n, WORLD_HEIGHT);
+	printf("  total:      %.2f ms (%.1f columns/s)\n", busy_ns / 1e6, n / (busy_ns / 1e9));
+	printf("  per column: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+	       bench_percentile(column_ns, n, 50.0) / 1e6,
+	       bench_percentile(column_ns, n, 99.0) / 1e6,
+	       column_ns[n - 1] / 1e6);
+	printf("  stages:\n");
+	for (int s = 0; s < STAGE_COUNT; s++) {
+		printf("    %-10s %10.2f ms %6.1f%% %9.3f ms/column\n",
+		       stage_names[s], stage_ns[s] / 1e6,
+		       busy_ns ? 100.0 * stage_ns[s] / busy_ns : 0.0,
+		       stage_ns[s] / 1e6 / n);
+	}
+	size_t chunk_count = (size_t)grid * grid * WORLD_HEIGHT;
+	size_t flat_bytes  = chunk_count * CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE * sizeof(Block);
+	printf("  storage:    %.1f KiB (%.1f%% of flat Block arrays), %zu/%zu chunks uniform\n",
+	       storage_bytes / 1024.0, 100.0 * storage_bytes / flat_bytes, uniform_chunks, chunk_count);
+	printf("  summary:    %zu/%zu chunks empty, %zu all full cubes, %zu with an opaque face\n",
+	       empty_chunks, chunk_count, solid_chunks, opaque_face_chunks);
+	uint64_t noise_batch, noise_scalar;
+	bool noise_ok = noise_check(&noise_batch, &noise_scalar);
+	printf("  noise:      batch %016llx, scalar %016llx, %s\n",
+	       (unsigned long long)noise_batch, (unsigned long long)noise_scalar,
+	       noise_ok ? "batch matches scalar" : "BATCH MISMATCH");
+	printf("  rle:        %s\n", rle_check() ? "adversarial round trips within bound" : "RLE ROUND TRIP FAILED");
+	printf("  checksum:   %016llx\n", (unsigned long long)checksum);
+
+	if (save_dir) {
+		region_flush();
+		uint64_t reload_checksum = 0xcbf29ce484222325ull;
+		uint64_t reload_ns = 0;
+		size_t reloaded = 0;
+		for (int gx = 0; gx < grid; gx++) {
+			for (int gz = 0; gz < grid; gz++) {
+				for (int cy = 0; cy < WORLD_HEIGHT; cy++)
+					chunk_free_storage(&column[cy]);
+				memset(column, 0, WORLD_HEIGHT * sizeof(Chunk));
+				uint64_t t0 = bench_now_ns();
+				bool ok = region_load_column(origin_x + gx, origin_z + gz, column);
+				reload_ns += bench_now_ns() - t0;
+				if (!ok) continue;
+				reloaded++;
+				reload_checksum = column_checksum(reload_checksum, column);
+			}
+		}
+		region_shutdown();
+		printf("  reload:     %zu/%d columns, %.3f ms/column (%.1fx faster than generating), %s\n",
+		       reloaded, grid * grid, reloaded ? reload_ns / 1e6 / reloaded : 0.0,
+		       reload_ns ? (double)busy_ns / n / ((double)reload_ns / (reloaded ? reloaded : 1)) : 0.0,
+		       reload_checksum == checksum ? "checksum matches" : "CHECKSUM MISMATCH");
+	}
+
+	chunk_column_release(column);
+	free(column_ns);
+	structure_cache_clear();
+	bench_teardown_world();
+	return 0;
+}
@@ -40,6 +40,8 @@ typedef struct {
 	bool face_culling;
 	bool occlusion_culling;
 	bool fancy_graphics;
+	bool quad_pulling;  // chunks as one record per quad, expanded by world.vert
+	int worker_threads;  // 0 picks one per core
 
 	bool auto_jump;
 } config;
@@ -0,0 +1,58 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAX_WORKER_THREADS 64
+#define JOB_MAX_DEPS 12
+#define JOB_ARENA_SIZE (1 << 20)
+
+// Workers always run the most urgent job they can find, their own or stolen.
+typedef enum {
+	JOB_PRIORITY_HIGH,    // player edits
+	JOB_PRIORITY_NORMAL,  // relighting and meshing
+	JOB_PRIORITY_LOW,     // column generation
+	JOB_PRIORITY_COUNT
+} job_priority_t;
+
+// worker is the index of the running worker, for per-worker scratch space.
+typedef void (*job_func_t)(void* arg, int worker);
+
+typedef struct job job_t;
+
+// Bump allocator for a job's scratch memory. Every worker owns one and
+// empties it after each job, so nothing allocated from it outlives the job.
+typedef struct {
+	uint8_t* base;
+	size_t size, used;
+} arena_t;
+
+// Counts outstanding work. Jobs can wait on counters and only become
+// runnable once every one of them is zero.
+typedef struct {
+	int value;
+	job_t* waiting;
+	pthread_mutex_t mutex;
+} job_counter_t;
+
+bool jobs_init(int thread_count);
+void jobs_shutdown();
+int jobs_thread_count();
+void job_counter_init(job_counter_t* counter);
+void job_counter_destroy(job_counter_t* counter);
+void job_counter_add(job_counter_t* counter, int amount);
+void job_counter_done(job_counter_t* counter);
+bool job_submit(job_func_t func, void* arg, job_priority_t priority);
+bool job_submit_after(job_func_t func, void* arg, job_priority_t priority,
+                      job_counter_t* const* deps, int dep_count);
+arena_t* job_arena(int worker);
+void* arena_alloc(arena_t* arena, size_t size);
+bool arena_extend(arena_t* arena, void* p, size_t size, size_t new_size);
+void arena_pop(arena_t* arena, void* p, size_t size);
+size_t arena_mark(const arena_t* arena);
+void arena_release(arena_t* arena, size_t mark);
+
+#endif
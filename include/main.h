@@ -1,14 +1,18 @@
 #ifndef MAIN_H
 #define MAIN_H
 
+// HEADLESS builds (make bench) only pull in the world/mesh code, no GL or windowing.
+#ifndef HEADLESS
 #define GLFW_EXPOSE_NATIVE_WAYLAND
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <GLFW/glfw3native.h>
 #include <wayland-client.h>
+#endif
 #include <stdbool.h>
 #include "misc.h"
 #include "world.h"
+#include "jobs.h"
 
 #ifdef DEBUG
 #include "profiler.h"
@@ -34,9 +38,11 @@ extern float near;
 extern float far;
 extern float aspect;
 extern bool game_focused;
-extern GLFWwindow* window;
 
 // Function prototypes
+#ifndef HEADLESS
+extern GLFWwindow* window;
+
 int initialize_window();
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
@@ -44,7 +50,7 @@ void cursor_position_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void set_hotbar_slot(uint8_t slot);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
-void process_input(GLFWwindow* window, Chunk*** chunks);
+void process_input(GLFWwindow* window, chunk_slot_t*** chunks);
 void setup_matrices();
 void set_fov(float fov);
 void limit_fps();
@@ -53,37 +59,95 @@ void touch_down(void *data, struct wl_touch *wl_touch, uint32_t serial, uint32_t
 void touch_up(void *data, struct wl_touch *wl_touch, uint32_t serial, uint32_t time, int32_t id);
 void touch_motion(void *data, struct wl_touch *wl_touch, uint32_t time, int32_t id, wl_fixed_t x, wl_fixed_t y);
 void check_touch_hold();
+#endif
 
-Block* get_block_at(Chunk*** chunks, int world_block_x, int world_block_y, int world_block_z);
+bool get_block_at(int world_block_x, int world_block_y, int world_block_z, Block* out);
 void draw_block_highlight(vec3 pos, uint8_t block_id);
-int is_block_solid(Chunk*** chunks, int world_block_x, int world_block_y, int world_block_z);
+int is_block_solid(chunk_slot_t*** chunks, int world_block_x, int world_block_y, int world_block_z);
 void calculate_chunk_and_block(int world_coord, int* chunk_coord, int* block_coord);
-bool is_chunk_in_bounds(int render_x, int chunk_y, int render_z);
-void update_adjacent_chunks(Chunk*** chunks, uint8_t render_x, uint8_t render_y, uint8_t render_z, int block_x, int block_y, int block_z);
+int chunk_slot(int chunk_coord);
+int slot_chunk_coord(int slot, int offset);
+bool is_chunk_in_bounds(int chunk_x, int chunk_y, int chunk_z);
+Chunk* get_chunk(int chunk_x, int chunk_y, int chunk_z);
+void update_adjacent_chunks(int chunk_x, int chunk_y, int chunk_z, int block_x, int block_y, int block_z);
 void generate_single_block_mesh(float x, float y, float z, uint8_t block_id, Mesh faces[6]);
-void add_quad(Chunk* chunk, float x, float y, float z, uint8_t normal, uint8_t texture_id,
+void clear_face_data(Mesh faces[6]);
+void add_quad(bool is_liquid, float x, float y, float z, uint8_t normal, uint8_t texture_id,
 			  const face_vertex_t face_data[4], uint8_t width, uint8_t height,
 			  uint8_t sky_light, uint8_t block_light,
-			  Vertex vertices[], uint32_t indices[],
-			  uint32_t* vertex_count, uint32_t* index_count);
+			  Vertex vertices[], uint32_t* vertex_count);
+
+// Chunk ids and light plus a one-block halo from the six face neighbours,
+// indexed [x + 1][y + 1][z + 1]. Taken under the column locks so meshing
+// never reads the live grid.
+#define SNAPSHOT_SIZE (CHUNK_SIZE + 2)
+typedef struct {
+	int32_t x, y, z;
+	uint8_t id   [SNAPSHOT_SIZE][SNAPSHOT_SIZE][SNAPSHOT_SIZE];
+	uint8_t light[SNAPSHOT_SIZE][SNAPSHOT_SIZE][SNAPSHOT_SIZE];
+} chunk_snapshot_t;
 
-bool init_mesh_thread();
-void cleanup_mesh_thread();
+// One quad as the mesher finds it, turned into vertices once the size of the
+// whole mesh is known. x, y, z are chunk-local; light is PACK_LIGHT'd.
+typedef struct {
+	uint8_t x, y, z, face;
+	uint8_t texture_id, width, height, light;
+	uint8_t shape;  // QUAD_CUBE, QUAD_SLAB or QUAD_CROSS
+	bool liquid;
+} mesh_quad_t;
+
+// Every block face of a chunk makes at most one quad.
+#define MESH_MAX_QUADS (MAX_VERTICES / 4)
+
+// Per-worker scratch space for generate_chunk_mesh, sized for a full chunk.
+typedef struct {
+	chunk_snapshot_t snapshot;
+	mesh_quad_t *quads[2];  // opaque, transparent
+} mesh_scratch_t;
+
+// Columns a mesh job waits on: every column within two steps of its own.
+#define MESH_COLUMN_DEPS 12
+#if MESH_COLUMN_DEPS > JOB_MAX_DEPS
+#error "mesh jobs wait on more counters than a job can hold"
+#endif
+
+bool init_mesh_workers();
+void cleanup_mesh_workers();
+bool queue_chunk_mesh(uint8_t x, uint8_t y, uint8_t z, job_priority_t priority,
+                      job_counter_t* const* deps, int dep_count);
 void enqueue_chunk_update_priority(uint8_t x, uint8_t y, uint8_t z);
+int mesh_column_deps(int cx, int cz, job_counter_t* deps[MESH_COLUMN_DEPS]);
 unsigned char* generate_light_texture();
 
-bool are_all_neighbors_loaded(uint8_t x, uint8_t y, uint8_t z);
-bool is_face_visible(Chunk* chunk, int8_t x, int8_t y, int8_t z, uint8_t face);
+bool are_all_neighbors_loaded(const Chunk *chunk);
+bool chunk_mesh_is_empty(const Chunk *chunk);
+// Visible faces of one chunk: rows[face][d][v] has bit u set when the block at
+// map_coordinates(face, u, v, d) needs a quad on that face.
+typedef struct {
+	uint16_t rows[6][CHUNK_SIZE][CHUNK_SIZE];
+} face_masks_t;
+
+void snapshot_chunk(Chunk* chunk, chunk_snapshot_t* snap);
+void build_face_masks(const chunk_snapshot_t* snap, face_masks_t* out);
 void map_coordinates(uint8_t face, uint8_t u, uint8_t v, uint8_t d, uint8_t* x, uint8_t* y, uint8_t* z);
-uint8_t get_face_light(Chunk* chunk, int x, int y, int z, uint8_t face);
-uint8_t find_width(Chunk* chunk, uint8_t face, uint8_t u, uint8_t v, uint8_t x, uint8_t y, uint8_t z, bool mask[CHUNK_SIZE][CHUNK_SIZE], Block* block);
-uint8_t find_height(Chunk* chunk, uint8_t face, uint8_t u, uint8_t v, uint8_t x, uint8_t y, uint8_t z, bool mask[CHUNK_SIZE][CHUNK_SIZE], Block* block, uint8_t width);
-void generate_chunk_mesh(Chunk* chunk);
+uint8_t get_face_light(const chunk_snapshot_t* snap, int x, int y, int z, uint8_t face);
+bool mesh_scratch_init(mesh_scratch_t* scratch);
+void mesh_scratch_free(mesh_scratch_t* scratch);
+// Meshes scratch->snapshot, filled beforehand by snapshot_chunk, into a new
+// block for out. Release it with chunk_mesh_free.
+void generate_chunk_mesh(mesh_scratch_t* scratch, chunk_mesh_t* out);
+void chunk_mesh_free(chunk_mesh_t* mesh);
+void mesh_block_pool_clear();
 void init_chunk_lighting(Chunk* chunk);
-void init_column_lighting(Chunk column[WORLD_HEIGHT]);
+void init_column_lighting(Chunk column[WORLD_HEIGHT], const column_context_t* ctx);
+void scan_column_sky(Chunk column[WORLD_HEIGHT]);
 void update_block_lighting(int wx, int wy, int wz, uint8_t old_id, uint8_t new_id);
 
-Chunk*** allocate_chunks();
-void free_chunks(Chunk*** chunks);
+chunk_slot_t*** allocate_chunks();
+void free_chunks(chunk_slot_t*** chunks);
+Chunk* chunk_column_acquire();
+void chunk_column_release(Chunk* column);
+column_sky_t* column_sky(Chunk* column);
+void chunk_column_pool_clear();
 
 #endif
\ No newline at end of file
@@ -3,17 +3,33 @@
 
 #include "misc.h"
 #include <stdatomic.h>
+#include <stdbool.h>
 
 typedef struct Chunk Chunk;
 
+// Positions are relative to the mesh's origin: the chunk_origin uniform for
+// chunk meshes, the model matrix alone for single blocks.
+//   position: x, y, z in 1/16 blocks at bits 0, 9 and 18, normal at bit 27
+//   data:     texture id at bit 0, u and v in half blocks at bits 8 and 14,
+//             sky light at bit 20, block light at bit 24
 typedef struct {
-	int32_t  x;
-	uint16_t y;
-	int32_t  z;
-	uint16_t packed_data;
-	uint32_t packed_size;
+	uint32_t position;
+	uint32_t data;
 } Vertex;
 
+// One whole quad, expanded into its corners by world.vert when chunks are
+// drawn with settings.quad_pulling. Positions are chunk-local blocks.
+//   position: x, y, z at bits 0, 4 and 8, width - 1 and height - 1 at bits
+//             12 and 16, face at bit 20, shape at bit 23, liquid at bit 25
+//   data:     as in Vertex, with u and v left zero
+typedef struct {
+	uint32_t position;
+	uint32_t data;
+} quad_record_t;
+
+// Quad shapes; world.vert keeps the same corner tables.
+enum { QUAD_CUBE, QUAD_SLAB, QUAD_CROSS };
+
 typedef struct {
 	float pos[3];
 	float uv[2];
@@ -26,11 +42,41 @@ typedef struct {
 	uint16_t  index_count;
 } Mesh;
 
-#define PACK_VERTEX_DATA(normal, texture_id) \
-	((uint16_t)(normal) | ((uint16_t)(texture_id) << 8))
+// Where one face's quads sit within their pass of a chunk_mesh_t, counted in
+// vertices from the start of the pass.
+typedef struct {
+	uint32_t first_vertex;
+	uint16_t vertex_count;
+} mesh_range_t;
+
+// A chunk's whole mesh in one pooled block, laid out for upload: the opaque
+// pass, then the transparent pass. Each pass is either vertices, every four
+// of them a quad drawn through the shared quad index buffer, or with
+// settings.quad_pulling one record per quad. Counts and ranges are in
+// vertices either way, four per quad. A zeroed chunk_mesh_t is an empty mesh.
+typedef struct {
+	void     *block;
+	uint32_t  block_size;
+	Vertex   *vertices[2];
+	quad_record_t *records[2];
+	uint32_t  vertex_count[2];
+	mesh_range_t faces[2][6];
+} chunk_mesh_t;
+
+#define PACK_VERTEX_POSITION(x, y, z, normal) \
+	((uint32_t)(x) | ((uint32_t)(y) << 9) | ((uint32_t)(z) << 18) | ((uint32_t)(normal) << 27))
+
+#define PACK_VERTEX_DATA(texture_id, u, v, sky_light, block_light) \
+	((uint32_t)(texture_id) | ((uint32_t)(u) << 8) | ((uint32_t)(v) << 14) | \
+	 ((uint32_t)(sky_light) << 20) | ((uint32_t)(block_light) << 24))
+
+#define PACK_QUAD_POSITION(x, y, z, width, height, face, shape, liquid) \
+	((uint32_t)(x) | ((uint32_t)(y) << 4) | ((uint32_t)(z) << 8) | \
+	 ((uint32_t)((width) - 1) << 12) | ((uint32_t)((height) - 1) << 16) | \
+	 ((uint32_t)(face) << 20) | ((uint32_t)(shape) << 23) | ((uint32_t)(liquid) << 25))
 
-#define PACK_SIZE_DATA(size_u, size_v) \
-	((uint32_t)(size_u) | ((uint32_t)(size_v) << 9))
+// Indices drawing vertex_count vertices as quads.
+#define QUAD_INDEX_COUNT(vertex_count) ((vertex_count) / 4 * 6)
 
 extern bool       mesh_mode;
 extern bool       frustum_changed;
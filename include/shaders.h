@@ -5,6 +5,8 @@ extern unsigned int atlas_uniform_location;
 extern unsigned int view_uniform_location;
 extern unsigned int projection_uniform_location;
 extern unsigned int highlight_uniform_location;
+extern unsigned int chunk_origin_uniform_location;
+extern unsigned int quad_records_uniform_location;
 extern unsigned int ui_projection_uniform_location;
 extern unsigned int ui_state_uniform_location;
 extern unsigned int screen_texture_uniform_location;
@@ -19,6 +19,15 @@ float stb_perlin_fbm_noise3(float x, float y, float z, float lacunarity, float g
 float stb_perlin_turbulence_noise3(float x, float y, float z, float lacunarity, float gain, int octaves);
 float stb_perlin_noise3_wrap_nonpow2(float x, float y, float z, int x_wrap, int y_wrap, int z_wrap, unsigned char seed);
 
+// Batched variants (not upstream): out[i] for count points, evaluated 8 (AVX2)
+// or 4 (NEON, SSE2) at a time. Results match the scalar calls without wrapping.
+// perlin_noise2 is stb_perlin_noise3(x, 0, z, 0, 0, 0) on the 4 y=0 corners only.
+float perlin_noise2(float x, float z);
+void perlin_noise2_batch(const float* x, const float* z, float* out, int count);
+void perlin_noise3_batch(const float* x, const float* y, const float* z, float* out, int count);
+void perlin_fbm_noise3_batch(const float* x, const float* y, const float* z, float* out, int count,
+                             float lacunarity, float gain, int octaves);
+
 #ifdef __cplusplus
 }
 #endif
@@ -4,6 +4,8 @@
 #include "renderer.h"
 #include <pthread.h>
 #include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct Entity Entity;
@@ -37,10 +39,45 @@ typedef struct {
 
 typedef struct {
 	structure_block_t* blocks;
-	uint8_t block_count;
+	uint16_t block_count;
 	uint8_t width, height, depth;
 } structure_t;
 
+// One structure block clipped to a chunk; pos packs the chunk-local
+// x << 8 | y << 4 | z.
+typedef struct {
+	uint16_t pos;
+	uint8_t id;
+} structure_cell_t;
+
+typedef struct structure_region structure_region_t;
+
+// Terrain inputs shared by every chunk of a column, computed once per column
+// job instead of once per chunk. Release it once the column is generated.
+typedef struct {
+	int cx, cz;
+	int16_t height[CHUNK_SIZE][CHUNK_SIZE];   // terrain surface y
+	int16_t surface[CHUNK_SIZE][CHUNK_SIZE];  // highest possibly non-air y (water, trees included)
+	bool ocean[CHUNK_SIZE][CHUNK_SIZE];
+	bool beach[CHUNK_SIZE][CHUNK_SIZE];
+	int min_height, max_height;
+	// Structure cells of chunk cy: structure_cells[structure_start[cy]] up to
+	// structure_cells[structure_start[cy + 1]], borrowed from structures.
+	structure_region_t* structures;
+	const structure_cell_t* structure_cells;
+	const uint32_t* structure_start;
+} column_context_t;
+
+// Where the sky stops reaching down each block column of a chunk column.
+// Between dark and top there are only air and partially opaque blocks
+// (water, leaves), so the sky light reaching any height is known without
+// reading blocks above top or at or below dark. Kept by init_column_lighting,
+// scan_column_sky and update_block_lighting.
+typedef struct {
+	int16_t top[CHUNK_SIZE][CHUNK_SIZE];   // highest block with any sky opacity, -1 if none
+	int16_t dark[CHUNK_SIZE][CHUNK_SIZE];  // highest y no sky light reaches, -1 if none
+} column_sky_t;
+
 typedef struct Block {
 	uint8_t id;
 	uint8_t light_level;
@@ -52,29 +89,64 @@ typedef struct Block {
 #define BLOCK_LIGHT(b)	   ((b) & 0xF)
 #define PACK_LIGHT(sky, blk) ((uint8_t)(((sky) << 4) | ((blk) & 0xF)))
 
+// What a chunk's block ids add up to, refreshed by chunk_update_summary
+// whenever they change so later stages can skip trivial chunks without
+// reading them. A zeroed summary (no blocks, not known uniform) is correct
+// for a zeroed chunk.
+typedef struct {
+	uint16_t block_count;   // non-air blocks
+	uint16_t cube_count;    // full opaque cubes (the mesher's hidden-face case)
+	bool uniform;           // every block is uniform_id
+	uint8_t uniform_id;
+	uint8_t opaque_faces;   // bit f: the boundary layer on face f is all opaque
+	bool has_emitters;
+} chunk_summary_t;
+
+// Block ids are palette-compressed: a uniform chunk (palette_bits == 0) is
+// just palette[0], otherwise indices holds a 1/2/4/8-bit palette index per
+// block. Light is only allocated once it stops being uniform (light_fill).
+// A zeroed Chunk is uniform air with no light. Go through the chunk_*
+// accessors below rather than touching these fields.
 typedef struct Chunk {
-	Block blocks[CHUNK_SIZE][CHUNK_SIZE][CHUNK_SIZE];
+	uint8_t* indices;
+	uint8_t* light;
+	uint8_t palette[MAX_BLOCK_TYPES];
+	uint16_t palette_size;
+	uint8_t palette_bits;
+	uint8_t light_fill;
 	int32_t x, y, z;
 	uint8_t ci_x, ci_y, ci_z;
-	bool needs_update;
-	bool is_loaded;
+	// needs_update, is_loaded and the mesh flags are written under the
+	// column lock of the chunk's slot; being atomic, the main thread's
+	// per-frame scans read them without it.
+	_Atomic bool needs_update;
+	_Atomic bool is_loaded;
 	bool lighting_changed;
+	bool light_fresh;  // light only holds init_column_lighting's seeds, see relight_chunk
+	bool dirty;  // generated or edited since it was last written to its region file
+	chunk_summary_t summary;
 
-	Mesh faces[6];
-	Mesh transparent_faces[6];
+	chunk_mesh_t mesh;
 
 	// Per-chunk GPU buffers — uploaded once when mesh is built,
 	// drawn directly without any CPU-side merge pass.
-	uint32_t opaque_vao, opaque_vbo, opaque_ebo;
-	uint32_t transparent_vao, transparent_vbo, transparent_ebo;
+	uint32_t opaque_vao, opaque_vbo;
+	uint32_t transparent_vao, transparent_vbo;
 	uint32_t opaque_index_count;
 	uint32_t transparent_index_count;
 	bool gpu_buffers_valid;
-	bool mesh_dirty;  // set by mesh thread after building, cleared by main thread after upload
+	_Atomic bool mesh_dirty;  // set by a mesh job after building, cleared by main thread after upload
+	_Atomic bool mesh_busy;   // a mesh worker currently owns this chunk
+	_Atomic bool mesh_queued; // a mesh job for this slot is queued or waiting
 } Chunk;
 
+// A ring slot's chunk pointer. It changes under the slot's column lock, and
+// is atomic because the main thread's per-frame scans read it without.
+typedef _Atomic(Chunk*) chunk_slot_t;
+
 extern uint8_t block_data[MAX_BLOCK_TYPES][8];
-extern Chunk*** chunks;
+uint8_t block_emission(uint8_t id);
+extern chunk_slot_t*** chunks;
 
 extern structure_block_t tree_blocks[];
 extern structure_t tree_structure;
@@ -89,20 +161,70 @@ static const float cave_simplex_scale = 0.1f;
 static const float structure_scale = 0.1f;
 static const bool flat_world_gen = false;
 
-extern pthread_mutex_t chunks_mutex;
+// See functions.c for the locking rules.
+extern pthread_rwlock_t chunk_window_lock;
+
+// Ring slots locked by column_lock_area, in lock order.
+typedef struct {
+	int count;
+	int slots[9];
+} column_area_t;
+
+// Holds the read lock of the column read_block_at last read from.
+typedef struct {
+	int slot;
+} column_cursor_t;
+#define COLUMN_CURSOR_INIT { -1 }
 extern _Atomic int world_offset_x;
 extern _Atomic int world_offset_z;
 
+void column_read_lock(int x, int z);
+bool column_try_read_lock(int x, int z);
+void column_write_lock(int x, int z);
+void column_unlock(int x, int z);
+void column_lock_area(column_area_t* area, int x, int z);
+void column_unlock_area(const column_area_t* area);
+bool read_block_at(column_cursor_t* cursor, int world_block_x, int world_block_y, int world_block_z, Block* out);
+void column_cursor_release(column_cursor_t* cursor);
 void process_chunks();
 void load_around_entity(Entity* entity);
-void load_chunk_data(Chunk* chunk, unsigned char ci_x, unsigned char ci_y, unsigned char ci_z, int cx, int cy, int cz);
+void load_chunk_data(Chunk* chunk, const column_context_t* ctx, unsigned char ci_x, unsigned char ci_y, unsigned char ci_z, int cy);
 void unload_chunk(Chunk* chunk);
-void generate_chunk_terrain(Chunk* chunk, int chunk_x, int chunk_y, int chunk_z);
+void generate_column_context(column_context_t* ctx, int cx, int cz);
+void release_column_context(column_context_t* ctx);
+int terrain_height(float continent, float flatness, float mountain);
+void generate_chunk_terrain(Chunk* chunk, const column_context_t* ctx, int chunk_y);
 bool can_place_tree(int world_x, int surface_y, int world_z, bool is_grass_surface);
-void generate_structure_in_chunk(Chunk* chunk, int chunk_x, int chunk_y, int chunk_z,
-							   structure_t* structure, int structure_world_x, int structure_world_y, int structure_world_z,
-							   bool* empty_chunk);
-void start_world_gen_thread();
-void stop_world_gen_thread();
+structure_region_t* structure_acquire_column(int cx, int cz, const structure_cell_t** cells, const uint32_t** start);
+void structure_release(structure_region_t* region);
+void structure_cache_clear();
+uint8_t chunk_get_id(const Chunk* chunk, int x, int y, int z);
+void chunk_set_id(Chunk* chunk, int x, int y, int z, uint8_t id);
+uint8_t chunk_get_light(const Chunk* chunk, int x, int y, int z);
+void chunk_set_light(Chunk* chunk, int x, int y, int z, uint8_t level);
+Block chunk_get_block(const Chunk* chunk, int x, int y, int z);
+void chunk_fill_light(Chunk* chunk, uint8_t level);
+bool chunk_is_uniform(const Chunk* chunk, uint8_t id);
+void chunk_copy_ids(const Chunk* chunk, uint8_t out[CHUNK_SIZE][CHUNK_SIZE][CHUNK_SIZE]);
+void chunk_copy_light(const Chunk* chunk, uint8_t out[CHUNK_SIZE][CHUNK_SIZE][CHUNK_SIZE]);
+void chunk_compact(Chunk* chunk);
+void chunk_update_summary(Chunk* chunk);
+void chunk_clear_light(Chunk* chunk);
+void chunk_free_storage(Chunk* chunk);
+size_t chunk_storage_bytes(const Chunk* chunk);
+size_t chunk_serialize(const Chunk* chunk, uint8_t* out);
+size_t chunk_deserialize(Chunk* chunk, const uint8_t* in, size_t size);
+bool region_init(const char* dir);
+void region_shutdown();
+void region_flush();
+bool region_load_column(int cx, int cz, Chunk column[WORLD_HEIGHT]);
+void region_save_column(Chunk* const column[WORLD_HEIGHT]);
+// Largest region_rle_encode output for size input bytes.
+#define REGION_RLE_BOUND(size) ((size) + (size) / 128 + 1)
+size_t region_rle_encode(const uint8_t* in, size_t size, uint8_t* out);
+bool region_rle_decode(const uint8_t* in, size_t size, uint8_t* out, size_t out_size);
+void release_retired_columns();
+void start_world_gen();
+void stop_world_gen();
 
 #endif
\ No newline at end of file
@@ -2,15 +2,14 @@
 precision highp float;
 precision highp int;
 
-layout(location = 0) in int   aPosX;
-layout(location = 1) in uint  aPosY;
-layout(location = 2) in int   aPosZ;
-layout(location = 3) in uint  inPackedData;
-layout(location = 4) in uint  packed_size;
+layout(location = 0) in uint  aPosition;
+layout(location = 1) in uint  aData;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat4  model;
+uniform mat4  view;
+uniform mat4  projection;
+uniform ivec3 chunk_origin; // in blocks
+uniform bool  quad_records; // attributes hold one quad record per instance
 
 flat out uint  packedID;
 out      vec2  size;
@@ -21,19 +20,102 @@ flat out vec2  lightLevel;
 const float TEX_SIZE    = 16.0 / 256.0;
 const uint  ATLAS_WIDTH = 16u;
 
+// Quad corners by shape * 24 + face * 4 + corner, as in mesh_generation.c:
+// cube, slab, then cross.
+const vec3 CORNER_POS[64] = vec3[64](
+	vec3(1.0, 1.0, 1.0), vec3(0.0, 1.0, 1.0), vec3(0.0, 0.0, 1.0), vec3(1.0, 0.0, 1.0),
+	vec3(1.0, 1.0, 0.0), vec3(1.0, 1.0, 1.0), vec3(1.0, 0.0, 1.0), vec3(1.0, 0.0, 0.0),
+	vec3(0.0, 1.0, 0.0), vec3(1.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), vec3(0.0, 0.0, 0.0),
+	vec3(0.0, 1.0, 1.0), vec3(0.0, 1.0, 0.0), vec3(0.0, 0.0, 0.0), vec3(0.0, 0.0, 1.0),
+	vec3(0.0, 0.0, 0.0), vec3(1.0, 0.0, 0.0), vec3(1.0, 0.0, 1.0), vec3(0.0, 0.0, 1.0),
+	vec3(0.0, 1.0, 1.0), vec3(1.0, 1.0, 1.0), vec3(1.0, 1.0, 0.0), vec3(0.0, 1.0, 0.0),
+	vec3(1.0, 0.5, 1.0), vec3(0.0, 0.5, 1.0), vec3(0.0, 0.0, 1.0), vec3(1.0, 0.0, 1.0),
+	vec3(1.0, 0.5, 0.0), vec3(1.0, 0.5, 1.0), vec3(1.0, 0.0, 1.0), vec3(1.0, 0.0, 0.0),
+	vec3(0.0, 0.5, 0.0), vec3(1.0, 0.5, 0.0), vec3(1.0, 0.0, 0.0), vec3(0.0, 0.0, 0.0),
+	vec3(0.0, 0.5, 1.0), vec3(0.0, 0.5, 0.0), vec3(0.0, 0.0, 0.0), vec3(0.0, 0.0, 1.0),
+	vec3(0.0, 0.0, 0.0), vec3(1.0, 0.0, 0.0), vec3(1.0, 0.0, 1.0), vec3(0.0, 0.0, 1.0),
+	vec3(0.0, 0.5, 1.0), vec3(1.0, 0.5, 1.0), vec3(1.0, 0.5, 0.0), vec3(0.0, 0.5, 0.0),
+	vec3(1.0, 1.0, 1.0), vec3(0.0, 1.0, 0.0), vec3(0.0, 0.0, 0.0), vec3(1.0, 0.0, 1.0),
+	vec3(0.0, 1.0, 1.0), vec3(1.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), vec3(0.0, 0.0, 1.0),
+	vec3(0.0, 1.0, 0.0), vec3(1.0, 1.0, 1.0), vec3(1.0, 0.0, 1.0), vec3(0.0, 0.0, 0.0),
+	vec3(1.0, 1.0, 0.0), vec3(0.0, 1.0, 1.0), vec3(0.0, 0.0, 1.0), vec3(1.0, 0.0, 0.0)
+);
+const vec2 CORNER_UV[64] = vec2[64](
+	vec2(1.0, 0.0), vec2(0.0, 0.0), vec2(0.0, 1.0), vec2(1.0, 1.0),
+	vec2(1.0, 0.0), vec2(0.0, 0.0), vec2(0.0, 1.0), vec2(1.0, 1.0),
+	vec2(1.0, 0.0), vec2(0.0, 0.0), vec2(0.0, 1.0), vec2(1.0, 1.0),
+	vec2(1.0, 0.0), vec2(0.0, 0.0), vec2(0.0, 1.0), vec2(1.0, 1.0),
+	vec2(0.0, 1.0), vec2(1.0, 1.0), vec2(1.0, 0.0), vec2(0.0, 0.0),
+	vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0),
+	vec2(1.0, 0.0), vec2(0.0, 0.0), vec2(0.0, 0.5), vec2(1.0, 0.5),
+	vec2(1.0, 0.0), vec2(0.0, 0.0), vec2(0.0, 0.5), vec2(1.0, 0.5),
+	vec2(1.0, 0.0), vec2(0.0, 0.0), vec2(0.0, 0.5), vec2(1.0, 0.5),
+	vec2(1.0, 0.0), vec2(0.0, 0.0), vec2(0.0, 0.5), vec2(1.0, 0.5),
+	vec2(0.0, 1.0), vec2(1.0, 1.0), vec2(1.0, 0.0), vec2(0.0, 0.0),
+	vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0),
+	vec2(1.0, 0.0), vec2(0.0, 0.0), vec2(0.0, 1.0), vec2(1.0, 1.0),
+	vec2(1.0, 0.0), vec2(0.0, 0.0), vec2(0.0, 1.0), vec2(1.0, 1.0),
+	vec2(1.0, 0.0), vec2(0.0, 0.0), vec2(0.0, 1.0), vec2(1.0, 1.0),
+	vec2(1.0, 0.0), vec2(0.0, 0.0), vec2(0.0, 1.0), vec2(1.0, 1.0)
+);
+const int QUAD_CORNER[6] = int[6](0, 1, 2, 0, 2, 3);
+
+// Builds this corner of the instance's quad record the way add_quad builds
+// vertices: far edges move out to the quad's size and the UVs tile with it.
+void expand_quad(out vec3 local, out vec2 uv) {
+	vec3  base   = vec3(float(aPosition & 0xFu), float((aPosition >> 4u) & 0xFu), float((aPosition >> 8u) & 0xFu));
+	float w      = float(((aPosition >> 12u) & 0xFu) + 1u);
+	float h      = float(((aPosition >> 16u) & 0xFu) + 1u);
+	uint  face   = (aPosition >> 20u) & 0x7u;
+	uint  shape  = (aPosition >> 23u) & 0x3u;
+	bool  liquid = ((aPosition >> 25u) & 1u) != 0u;
+
+	int  corner = int(shape * 24u + face * 4u) + QUAD_CORNER[gl_VertexID];
+	vec3 p      = CORNER_POS[corner];
+	local = base + p;
+	uv    = CORNER_UV[corner];
+
+	if (face == 0u || face == 2u) {
+		if (p.x == 1.0) local.x = base.x + w;
+		if (p.y == 1.0) local.y = base.y + h;
+	} else if (face == 1u || face == 3u) {
+		if (p.y == 1.0) local.y = base.y + h;
+		if (p.z == 1.0) local.z = base.z + w;
+	} else {
+		if (p.x == 1.0) local.x = base.x + w;
+		if (p.z == 1.0) local.z = base.z + h;
+	}
+	uv *= vec2(w, h);
+
+	if (liquid && (face == 5u || (face != 4u && p.y == 1.0)))
+		local.y -= 0.125;
+}
+
 void main() {
-	vec3 pos    = vec3(float(aPosX), float(aPosY), float(aPosZ)) / 16.0;
-	gl_Position = projection * view * model * vec4(pos, 1.0);
+	vec3 local;
+	vec2 uv;
+	uint faceID;
+	if (quad_records) {
+		expand_quad(local, uv);
+		faceID = (aPosition >> 20u) & 0x7u;
+	} else {
+		local = vec3(
+			float( aPosition         & 0x1FFu),
+			float((aPosition >>  9u) & 0x1FFu),
+			float((aPosition >> 18u) & 0x1FFu)
+		) / 16.0;
+		uv = vec2(
+			float((aData >>  8u) & 0x3Fu),
+			float((aData >> 14u) & 0x3Fu)
+		) / 2.0;
+		faceID = (aPosition >> 27u) & 0x7u;
+	}
+	gl_Position = projection * view * model * vec4(vec3(chunk_origin) + local, 1.0);
+	size        = uv;
 
-	uint faceID = inPackedData & 0xFFu;
-	uint texID  = (inPackedData >> 8) & 0xFFu;
+	uint texID  = aData & 0xFFu;
 	packedID    = (texID << 16) | faceID;
 
-	size = vec2(
-		float( packed_size        & 0x1FFu),
-		float((packed_size >>  9) & 0x1FFu)
-	) / 16.0;
-
 	texelSize = TEX_SIZE;
 
 	uint ti    = texID - 1u;
@@ -42,7 +124,7 @@ void main() {
 		float(ti / ATLAS_WIDTH) * TEX_SIZE
 	);
 
-	uint sky_raw   = (packed_size >> 18u) & 0xFu;
-	uint block_raw = (packed_size >> 22u) & 0xFu;
+	uint sky_raw   = (aData >> 20u) & 0xFu;
+	uint block_raw = (aData >> 24u) & 0xFu;
 	lightLevel = vec2(float(sky_raw) / 15.0, float(block_raw) / 15.0);
 }
@@ -49,6 +49,21 @@ void parse_config(IniFile* ini) {
 	if (gui_scale)
 		settings.gui_scale = atof(gui_scale);
 
+	// Older configs only have the mesh pool's thread count.
+	const char* worker_threads = ini_get(ini, "main", "worker_threads");
+	if (!worker_threads)
+		worker_threads = ini_get(ini, "render", "mesh_threads");
+	if (worker_threads) {
+		int threads = atoi(worker_threads);
+		if (threads < 0 || threads > MAX_WORKER_THREADS) {
+			int clamped = threads < 0 ? 0 : MAX_WORKER_THREADS;
+			fprintf(stderr, "worker_threads = %d is out of range 0..%d, using %d\n",
+			        threads, MAX_WORKER_THREADS, clamped);
+			threads = clamped;
+		}
+		settings.worker_threads = threads;
+	}
+
 	//
 	// [render]
 	//
@@ -75,6 +90,10 @@ void parse_config(IniFile* ini) {
 	if (fancy)
 		settings.fancy_graphics = fancy[0] == 't' || fancy[0] == 'T';
 
+	const char* quad_pulling = ini_get(ini, "render", "quad_pulling");
+	if (quad_pulling)
+		settings.quad_pulling = quad_pulling[0] == 't' || quad_pulling[0] == 'T';
+
 
 
 	//
@@ -153,6 +172,8 @@ void initialize_config() {
 	settings.face_culling = true;
 	settings.occlusion_culling = false;
 	settings.fancy_graphics = true;
+	settings.quad_pulling = false;
+	settings.worker_threads = 0;
 
 	settings.auto_jump = false;
 
@@ -184,12 +205,16 @@ void initialize_config() {
 		fprintf(config_file, "fps_limit = %d\n", settings.fps_limit);
 		fprintf(config_file, "vsync = true\n");
 		fprintf(config_file, "gui_scale = %.1f\n", settings.gui_scale);
+		fprintf(config_file, "; generation and meshing threads, 0 = number of cores - 1\n");
+		fprintf(config_file, "worker_threads = %d\n", settings.worker_threads);
 		fprintf(config_file, "\n[render]\n");
 		fprintf(config_file, "distance = %d\n", settings.render_distance / 2);
 		fprintf(config_file, "frustum_culling = true\n");
 		fprintf(config_file, "face_culling = true\n");
 		fprintf(config_file, "occlusion_culling = false\n");
 		fprintf(config_file, "fancy = true\n");
+		fprintf(config_file, "; upload one record per quad and build the vertices in the shader\n");
+		fprintf(config_file, "quad_pulling = false\n");
 		fprintf(config_file, "\n[input]\n");
 		fprintf(config_file, "auto_jump = false\n");
 		fclose(config_file);
@@ -9,7 +9,7 @@
 #include "framebuffer.h"
 
 uint8_t hotbar_slot = 0;
-Chunk*** chunks = NULL;
+chunk_slot_t*** chunks = NULL;
 Entity global_entities[MAX_ENTITIES_PER_CHUNK];
 
 int initialize() {
@@ -22,8 +22,9 @@ int initialize() {
 	init_ui();
 	init_gl_buffers();
 	skybox_init();
-	start_world_gen_thread();
-	init_mesh_thread();
+	jobs_init(settings.worker_threads);
+	start_world_gen();
+	init_mesh_workers();
 	cache_uniform_locations();
 
 	chunks = allocate_chunks();
@@ -61,18 +62,12 @@ void run() {
 
 void shutdown() {
 	// Stop background threads before freeing any shared data.
-	cleanup_mesh_thread();
-	stop_world_gen_thread();
+	jobs_shutdown();
+	cleanup_mesh_workers();
+	stop_world_gen();
 
-	// Free all chunk mesh memory, then the chunk grid itself.
+	// Free all chunk data and mesh memory along with the grid itself.
 	if (chunks) {
-		for (int x = 0; x < settings.render_distance; x++) {
-			for (int y = 0; y < WORLD_HEIGHT; y++) {
-				for (int z = 0; z < settings.render_distance; z++) {
-					unload_chunk(&chunks[x][y][z]);
-				}
-			}
-		}
 		free_chunks(chunks);
 		chunks = NULL;
 	}
@@ -36,7 +36,7 @@ vec3 get_direction(float pitch, float yaw) {
 	};
 }
 
-Block* get_targeted_block(Entity entity, vec3* pos_out, char* out_face) {
+bool get_targeted_block(Entity entity, vec3* pos_out, char* out_face, Block* out) {
 	vec3 position = entity.pos;
 	position.y += entity.eye_level;
 	vec3 direction = get_direction(global_entities[0].pitch, global_entities[0].yaw);
@@ -83,10 +83,13 @@ Block* get_targeted_block(Entity entity, vec3* pos_out, char* out_face) {
 		// Skip if out of bounds
 		if (block_y < 0 || block_y >= WORLD_HEIGHT * CHUNK_SIZE) continue;
 
-		Block* block = get_block_at(chunks, block_x, block_y, block_z);
-		if (block == NULL) continue;
+		Block block;
+		column_cursor_t cursor = COLUMN_CURSOR_INIT;
+		bool found = read_block_at(&cursor, block_x, block_y, block_z, &block);
+		column_cursor_release(&cursor);
+		if (!found) continue;
 
-		if (block->id != 0 && block->id != 8 && block->id != 9) {
+		if (block.id != 0 && block.id != 8 && block.id != 9) {
 			pos_out->x = block_x;
 			pos_out->y = block_y;
 			pos_out->z = block_z;
@@ -107,11 +110,12 @@ Block* get_targeted_block(Entity entity, vec3* pos_out, char* out_face) {
 			} else {
 				*out_face = (dz_intersect > 0) ? 'F' : 'K';
 			}
-			return block;
+			if (out) *out = block;
+			return true;
 		}
 	}
 
-	return NULL;
+	return false;
 }
 
 bool check_entity_collision(float x, float y, float z, float width, float height) {
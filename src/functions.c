@@ -1,40 +1,192 @@
+#define _GNU_SOURCE  // writer-preferring rwlock for chunk_window_lock
 #include "main.h"
 #include "world.h"
 #include "config.h"
 #include <stdlib.h>
+#include <string.h>
 
-Chunk*** allocate_chunks() {
-	Chunk*** chunks = (Chunk ***)malloc(settings.render_distance * sizeof(Chunk **));
-	if (!chunks) return NULL;
-	
-	chunks[0] = (Chunk **)malloc(settings.render_distance * WORLD_HEIGHT * sizeof(Chunk *));
-	if (!chunks[0]) {
-		free(chunks);
-		return NULL;
+// Columns of WORLD_HEIGHT chunks are recycled instead of freed, so a worker
+// can build a whole column off-grid and publish it with a pointer swap. Each
+// block holds the chunks followed by the column's sky map.
+#define COLUMN_BLOCK_SIZE (WORLD_HEIGHT * sizeof(Chunk) + sizeof(column_sky_t))
+static Chunk** column_pool = NULL;
+static int column_pool_count = 0;
+static int column_pool_capacity = 0;
+static pthread_mutex_t column_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Returns a zeroed column, or NULL if out of memory.
+Chunk* chunk_column_acquire() {
+	pthread_mutex_lock(&column_pool_mutex);
+	Chunk* column = column_pool_count ? column_pool[--column_pool_count] : NULL;
+	pthread_mutex_unlock(&column_pool_mutex);
+	if (!column)
+		column = calloc(1, COLUMN_BLOCK_SIZE);
+	return column;
+}
+
+// column must come from chunk_column_acquire.
+column_sky_t* column_sky(Chunk* column) {
+	return (column_sky_t*)(column + WORLD_HEIGHT);
+}
+
+// Frees the column's block, light and mesh data and returns it to the pool.
+// Nothing else may still reference it.
+void chunk_column_release(Chunk* column) {
+	if (!column) return;
+	for (int cy = 0; cy < WORLD_HEIGHT; cy++)
+		unload_chunk(&column[cy]);
+	memset(column, 0, COLUMN_BLOCK_SIZE);
+
+	pthread_mutex_lock(&column_pool_mutex);
+	if (column_pool_count == column_pool_capacity) {
+		int capacity = column_pool_capacity ? column_pool_capacity * 2 : 64;
+		Chunk** pool = realloc(column_pool, capacity * sizeof(Chunk*));
+		if (!pool) {
+			pthread_mutex_unlock(&column_pool_mutex);
+			free(column);
+			return;
+		}
+		column_pool = pool;
+		column_pool_capacity = capacity;
 	}
+	column_pool[column_pool_count++] = column;
+	pthread_mutex_unlock(&column_pool_mutex);
+}
+
+void chunk_column_pool_clear() {
+	pthread_mutex_lock(&column_pool_mutex);
+	for (int i = 0; i < column_pool_count; i++)
+		free(column_pool[i]);
+	free(column_pool);
+	column_pool = NULL;
+	column_pool_count = 0;
+	column_pool_capacity = 0;
+	pthread_mutex_unlock(&column_pool_mutex);
+}
+
+// Each ring column slot has a reader/writer lock guarding its chunks' data
+// and flags, so work on one column never waits on unrelated ones.
+// chunk_window_lock guards the window itself: the offset and which column
+// each slot holds. Worker threads read-lock it around any column lock and
+// the main thread write-locks it to scroll; being the only thread that
+// scrolls, the main thread takes column locks alone.
+// Lock order: chunk_window_lock, then column locks in slot order.
+pthread_rwlock_t chunk_window_lock;
+static pthread_rwlock_t* column_locks = NULL;
+static int column_lock_count = 0;
 
-	for (uint8_t i = 1; i < settings.render_distance; i++) {
-		chunks[i] = chunks[i-1] + WORLD_HEIGHT;
+static pthread_rwlock_t* column_lock(int x, int z) {
+	return &column_locks[x * settings.render_distance + z];
+}
+
+void column_read_lock(int x, int z)  { pthread_rwlock_rdlock(column_lock(x, z)); }
+void column_write_lock(int x, int z) { pthread_rwlock_wrlock(column_lock(x, z)); }
+void column_unlock(int x, int z)     { pthread_rwlock_unlock(column_lock(x, z)); }
+
+// For the main thread, which would rather skip a column than wait out a
+// mesh job relighting around it.
+bool column_try_read_lock(int x, int z) {
+	return pthread_rwlock_tryrdlock(column_lock(x, z)) == 0;
+}
+
+// Write-locks ring slot (x, z) and the slots around it: everything a chunk
+// in it reaches when relit, meshed or marking its neighbours. Slots wrap at
+// the grid edge, so a few may not be world neighbours; locking those too
+// is harmless.
+void column_lock_area(column_area_t* area, int x, int z) {
+	int rd = settings.render_distance;
+	area->count = 0;
+	for (int dx = -1; dx <= 1; dx++) {
+		for (int dz = -1; dz <= 1; dz++) {
+			int slot = chunk_slot(x + dx) * rd + chunk_slot(z + dz);
+			int i = area->count;
+			while (i > 0 && area->slots[i - 1] > slot) i--;
+			// Render distances below 3 wrap onto the same slot.
+			if (i > 0 && area->slots[i - 1] == slot) continue;
+			memmove(&area->slots[i + 1], &area->slots[i], (area->count - i) * sizeof(int));
+			area->slots[i] = slot;
+			area->count++;
+		}
 	}
+	for (int i = 0; i < area->count; i++)
+		pthread_rwlock_wrlock(&column_locks[area->slots[i]]);
+}
 
-	Chunk* chunk_block = (Chunk *)calloc(settings.render_distance * WORLD_HEIGHT * settings.render_distance, sizeof(Chunk));
-	if (!chunk_block) {
+void column_unlock_area(const column_area_t* area) {
+	for (int i = area->count - 1; i >= 0; i--)
+		pthread_rwlock_unlock(&column_locks[area->slots[i]]);
+}
+
+static bool init_chunk_locks(int count) {
+	pthread_rwlockattr_t attr;
+	pthread_rwlockattr_init(&attr);
+	// Workers keep read-locking the window; a scroll must still get in.
+	pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+	pthread_rwlock_init(&chunk_window_lock, &attr);
+	pthread_rwlockattr_destroy(&attr);
+
+	column_locks = malloc(count * sizeof(pthread_rwlock_t));
+	if (!column_locks) return false;
+	for (column_lock_count = 0; column_lock_count < count; column_lock_count++)
+		pthread_rwlock_init(&column_locks[column_lock_count], NULL);
+	return true;
+}
+
+static void free_chunk_locks() {
+	for (int i = 0; i < column_lock_count; i++)
+		pthread_rwlock_destroy(&column_locks[i]);
+	free(column_locks);
+	column_locks = NULL;
+	column_lock_count = 0;
+	pthread_rwlock_destroy(&chunk_window_lock);
+}
+
+// chunks[x][y][z] points into the column that ring slot (x, z) currently
+// holds; chunks[x][0][z] is the start of that column.
+chunk_slot_t*** allocate_chunks() {
+	int rd = settings.render_distance;
+	chunk_slot_t*** chunks = calloc(rd, sizeof(chunk_slot_t**));
+	if (!chunks) return NULL;
+
+	chunks[0] = malloc(rd * WORLD_HEIGHT * sizeof(chunk_slot_t*));
+	chunk_slot_t* slots = calloc(rd * WORLD_HEIGHT * rd, sizeof(chunk_slot_t));
+	if (!chunks[0] || !slots || !init_chunk_locks(rd * rd)) {
+		free_chunk_locks();
+		free(slots);
 		free(chunks[0]);
 		free(chunks);
 		return NULL;
 	}
 
-	for (uint8_t i = 0; i < settings.render_distance; i++) {
-		for (uint8_t j = 0; j < WORLD_HEIGHT; j++) {
-			chunks[i][j] = chunk_block + (i * WORLD_HEIGHT * settings.render_distance) + (j * settings.render_distance);
+	for (int i = 0; i < rd; i++) {
+		chunks[i] = chunks[0] + i * WORLD_HEIGHT;
+		for (int j = 0; j < WORLD_HEIGHT; j++)
+			chunks[i][j] = slots + (i * WORLD_HEIGHT + j) * rd;
+	}
+
+	for (int x = 0; x < rd; x++) {
+		for (int z = 0; z < rd; z++) {
+			Chunk* column = chunk_column_acquire();
+			if (!column) {
+				free_chunks(chunks);
+				return NULL;
+			}
+			for (int y = 0; y < WORLD_HEIGHT; y++)
+				chunks[x][y][z] = &column[y];
 		}
 	}
-	
+
 	return chunks;
 }
 
-void free_chunks(Chunk*** chunks) {
+void free_chunks(chunk_slot_t*** chunks) {
 	if (!chunks) return;
+	for (int x = 0; x < settings.render_distance; x++)
+		for (int z = 0; z < settings.render_distance; z++)
+			chunk_column_release(chunks[x][0][z]);
+	chunk_column_pool_clear();
+	mesh_block_pool_clear();
+	free_chunk_locks();
 	free(chunks[0][0]);
 	free(chunks[0]);
 	free(chunks);
@@ -45,31 +197,58 @@ void calculate_chunk_and_block(int world_coord, int* chunk_coord, int* block_coo
 	*block_coord = ((world_coord % CHUNK_SIZE) + CHUNK_SIZE) % CHUNK_SIZE;
 }
 
-bool is_chunk_in_bounds(int render_x, int chunk_y, int render_z) {
+// The chunk grid is a ring buffer: world chunk column (cx, cz) always lives
+// in slot (cx mod render_distance, cz mod render_distance), so scrolling the
+// window only re-targets the slots that fall off the edge.
+int chunk_slot(int chunk_coord) {
+	int rd = settings.render_distance;
+	return ((chunk_coord % rd) + rd) % rd;
+}
+
+// Chunk coordinate that ring slot `slot` holds for a window starting at offset.
+int slot_chunk_coord(int slot, int offset) {
+	return offset + chunk_slot(slot - offset);
+}
+
+bool is_chunk_in_bounds(int chunk_x, int chunk_y, int chunk_z) {
+	int render_x = chunk_x - (int)atomic_load(&world_offset_x);
+	int render_z = chunk_z - (int)atomic_load(&world_offset_z);
 	return (render_x >= 0 && render_x < settings.render_distance &&
 			chunk_y >= 0 && chunk_y < WORLD_HEIGHT &&
 			render_z >= 0 && render_z < settings.render_distance);
 }
 
-void update_adjacent_chunks(Chunk*** chunks, uint8_t render_x, uint8_t render_y, uint8_t render_z, int block_x, int block_y, int block_z) {
-	if (block_x == 0 && render_x > 0)
-		chunks[render_x - 1][render_y][render_z].needs_update = true;
-	else if (block_x == CHUNK_SIZE - 1 && render_x < settings.render_distance - 1)
-		chunks[render_x + 1][render_y][render_z].needs_update = true;
+// Slot for a world chunk coordinate, or NULL outside the loaded window.
+Chunk* get_chunk(int chunk_x, int chunk_y, int chunk_z) {
+	if (!is_chunk_in_bounds(chunk_x, chunk_y, chunk_z))
+		return NULL;
+	return chunks[chunk_slot(chunk_x)][chunk_y][chunk_slot(chunk_z)];
+}
+
+static void mark_chunk_for_update(int chunk_x, int chunk_y, int chunk_z) {
+	Chunk* chunk = get_chunk(chunk_x, chunk_y, chunk_z);
+	if (chunk) chunk->needs_update = true;
+}
+
+void update_adjacent_chunks(int chunk_x, int chunk_y, int chunk_z, int block_x, int block_y, int block_z) {
+	if (block_x == 0)
+		mark_chunk_for_update(chunk_x - 1, chunk_y, chunk_z);
+	else if (block_x == CHUNK_SIZE - 1)
+		mark_chunk_for_update(chunk_x + 1, chunk_y, chunk_z);
 
-	if (block_y == 0 && render_y > 0)
-		chunks[render_x][render_y - 1][render_z].needs_update = true;
-	else if (block_y == CHUNK_SIZE - 1 && render_y < WORLD_HEIGHT - 1)
-		chunks[render_x][render_y + 1][render_z].needs_update = true;
+	if (block_y == 0)
+		mark_chunk_for_update(chunk_x, chunk_y - 1, chunk_z);
+	else if (block_y == CHUNK_SIZE - 1)
+		mark_chunk_for_update(chunk_x, chunk_y + 1, chunk_z);
 
-	if (block_z == 0 && render_z > 0)
-		chunks[render_x][render_y][render_z - 1].needs_update = true;
-	else if (block_z == CHUNK_SIZE - 1 && render_z < settings.render_distance - 1)
-		chunks[render_x][render_y][render_z + 1].needs_update = true;
+	if (block_z == 0)
+		mark_chunk_for_update(chunk_x, chunk_y, chunk_z - 1);
+	else if (block_z == CHUNK_SIZE - 1)
+		mark_chunk_for_update(chunk_x, chunk_y, chunk_z + 1);
 }
 
-Block* get_block_at(Chunk*** chunks, int world_block_x, int world_block_y, int world_block_z) {
-	Block* block = NULL;
+// Caller holds the block's column lock.
+bool get_block_at(int world_block_x, int world_block_y, int world_block_z, Block* out) {
 	int chunk_x, chunk_z, block_x, block_z;
 	calculate_chunk_and_block(world_block_x, &chunk_x, &block_x);
 	calculate_chunk_and_block(world_block_z, &chunk_z, &block_z);
@@ -77,22 +256,48 @@ Block* get_block_at(Chunk*** chunks, int world_block_x, int world_block_y, int w
 	int chunk_y = world_block_y / CHUNK_SIZE;
 	int block_y = ((world_block_y % CHUNK_SIZE) + CHUNK_SIZE) % CHUNK_SIZE;
 
-	int render_x = chunk_x - (int)atomic_load(&world_offset_x);
-	int render_z = chunk_z - (int)atomic_load(&world_offset_z);
+	Chunk* chunk = get_chunk(chunk_x, chunk_y, chunk_z);
+	if (!chunk)
+		return false;
 
-	if (is_chunk_in_bounds(render_x, chunk_y, render_z)) {
-		Chunk* chunk = &chunks[render_x][chunk_y][render_z];
-		block = &chunk->blocks[block_x][block_y][block_z];
+	*out = chunk_get_block(chunk, block_x, block_y, block_z);
+	return true;
+}
+
+// Reads a block with its column read-locked. The lock is kept while
+// consecutive reads stay in that column, until column_cursor_release.
+// Main thread only, as it does not take chunk_window_lock.
+bool read_block_at(column_cursor_t* cursor, int world_block_x, int world_block_y, int world_block_z, Block* out) {
+	int chunk_x, chunk_z, block_x, block_z;
+	calculate_chunk_and_block(world_block_x, &chunk_x, &block_x);
+	calculate_chunk_and_block(world_block_z, &chunk_z, &block_z);
+	if (!is_chunk_in_bounds(chunk_x, 0, chunk_z))
+		return false;
+
+	int slot = chunk_slot(chunk_x) * settings.render_distance + chunk_slot(chunk_z);
+	if (cursor->slot != slot) {
+		column_cursor_release(cursor);
+		pthread_rwlock_rdlock(&column_locks[slot]);
+		cursor->slot = slot;
 	}
+	return get_block_at(world_block_x, world_block_y, world_block_z, out);
+}
 
-	return block;
+void column_cursor_release(column_cursor_t* cursor) {
+	if (cursor->slot >= 0)
+		pthread_rwlock_unlock(&column_locks[cursor->slot]);
+	cursor->slot = -1;
 }
 
-int is_block_solid(Chunk*** chunks, int world_block_x, int world_block_y, int world_block_z) {
-	Block* block = get_block_at(chunks, world_block_x, world_block_y, world_block_z);
-	if (block == NULL)
+int is_block_solid(chunk_slot_t*** chunks, int world_block_x, int world_block_y, int world_block_z) {
+	(void)chunks;
+	Block block;
+	column_cursor_t cursor = COLUMN_CURSOR_INIT;
+	bool found = read_block_at(&cursor, world_block_x, world_block_y, world_block_z, &block);
+	column_cursor_release(&cursor);
+	if (!found)
 		return 0; // unloaded = air, prevents phantom walls at chunk borders
-	return !(block->id == 0 || block->id == 6 || block->id == 37 || block->id == 38 ||
-			 block->id == 39 || block->id == 40 || block->id == 8 || block->id == 9 ||
-			 block->id == 10 || block->id == 11);
+	return !(block.id == 0 || block.id == 6 || block.id == 37 || block.id == 38 ||
+			 block.id == 39 || block.id == 40 || block.id == 8 || block.id == 9 ||
+			 block.id == 10 || block.id == 11);
 }
\ No newline at end of file
@@ -44,32 +44,31 @@ static bool is_ray_obstructed(vec3 start, vec3 end) {
 	float step = fminf(MAX_STEP_SIZE, fmaxf(MIN_STEP_SIZE, total * 0.01f));
 	int   max  = (int)(total / step) + 1;
 	int   solid = 0, air = 0;
+	bool  obstructed = false;
+	// Consecutive steps mostly stay in one column, which stays read-locked.
+	column_cursor_t cursor = COLUMN_CURSOR_INIT;
 	for (int i = 1; i < max; i++) {
 		float t = (float)i * step;
 		if (t >= total * 0.95f) break;
-		Block *b = get_block_at(chunks,
+		Block b;
+		if (!read_block_at(&cursor,
 		    start.x + dir.x * t,
 		    start.y + dir.y * t,
-		    start.z + dir.z * t);
-		if (!b) return false;
-		if (block_data[b->id][1] == 0) {
-			if (++solid >= 2) return true;
+		    start.z + dir.z * t, &b)) break;
+		if (block_data[b.id][1] == 0) {
+			if (++solid >= 2) { obstructed = true; break; }
 			air = 0;
 		} else if (++air > 5) {
 			solid = 0;
 		}
 	}
-	return false;
+	column_cursor_release(&cursor);
+	return obstructed;
 }
 
 static bool chunk_has_surface_blocks(int cx, int cy, int cz) {
-	int lx = cx - world_offset_x;
-	int lz = cz - world_offset_z;
-	if (lx < 0 || lx >= settings.render_distance ||
-	    lz < 0 || lz >= settings.render_distance ||
-	    cy < 0 || cy >= WORLD_HEIGHT) return false;
-	if (!chunks[lx][cy][lz].is_loaded) return false;
-	Chunk *c = &chunks[lx][cy][lz];
+	Chunk *c = get_chunk(cx, cy, cz);
+	if (!c) return false;
 	static const int sp[][3] = {
 		{0,0,0},{CHUNK_SIZE-1,0,0},{0,0,CHUNK_SIZE-1},{CHUNK_SIZE-1,0,CHUNK_SIZE-1},
 		{0,CHUNK_SIZE-1,0},{CHUNK_SIZE-1,CHUNK_SIZE-1,0},{0,CHUNK_SIZE-1,CHUNK_SIZE-1},
@@ -79,11 +78,45 @@ static bool chunk_has_surface_blocks(int cx, int cy, int cz) {
 		{CHUNK_SIZE/2,CHUNK_SIZE/2,0},{CHUNK_SIZE/2,CHUNK_SIZE/2,CHUNK_SIZE-1}
 	};
 	int n = 0;
-	for (int i = 0; i < (int)(sizeof(sp)/sizeof(sp[0])); i++)
-		if (c->blocks[sp[i][0]][sp[i][1]][sp[i][2]].id > 0) n++;
+	column_read_lock(chunk_slot(cx), chunk_slot(cz));
+	if (c->is_loaded && c->summary.block_count != 0)
+		for (int i = 0; i < (int)(sizeof(sp)/sizeof(sp[0])); i++)
+			if (chunk_get_id(c, sp[i][0], sp[i][1], sp[i][2]) > 0) n++;
+	column_unlock(chunk_slot(cx), chunk_slot(cz));
 	return n >= SAMPLE_BLOCK_THRESHOLD;
 }
 
+// Neighbour offset and the neighbour face that touches this chunk, for each
+// face in mesher order: 0 +z, 1 +x, 2 -z, 3 -x, 4 -y, 5 +y.
+static const struct { int8_t dx, dy, dz; uint8_t opposite; } seal_faces[6] = {
+	{ 0, 0, 1, 2 }, { 1, 0, 0, 3 }, { 0, 0,-1, 0 },
+	{-1, 0, 0, 1 }, { 0,-1, 0, 5 }, { 0, 1, 0, 4 }
+};
+
+// True when every face of the chunk that looks towards the viewer is covered
+// by a fully opaque boundary layer of the neighbour (summary.opaque_faces).
+// Any sight line into the chunk then crosses an opaque block first.
+static bool is_chunk_sealed(vec3 vp, int cx, int cy, int cz) {
+	float mnx = cx * CHUNK_SIZE, mny = cy * CHUNK_SIZE, mnz = cz * CHUNK_SIZE;
+	bool beyond[6] = {
+		vp.z > mnz + CHUNK_SIZE, vp.x > mnx + CHUNK_SIZE, vp.z < mnz,
+		vp.x < mnx,              vp.y < mny,              vp.y > mny + CHUNK_SIZE
+	};
+	bool any = false;
+	for (int f = 0; f < 6; f++) {
+		if (!beyond[f]) continue;
+		any = true;
+		int nx = cx + seal_faces[f].dx, nz = cz + seal_faces[f].dz;
+		Chunk *nc = get_chunk(nx, cy + seal_faces[f].dy, nz);
+		if (!nc) return false;
+		column_read_lock(chunk_slot(nx), chunk_slot(nz));
+		bool sealed = nc->is_loaded && (nc->summary.opaque_faces & (1 << seal_faces[f].opposite));
+		column_unlock(chunk_slot(nx), chunk_slot(nz));
+		if (!sealed) return false;
+	}
+	return any;
+}
+
 static int generate_test_points(int cx, int cy, int cz, vec3 vp, vec3 pts[MAX_TEST_POINTS]) {
 	vec3  cc  = chunk_center(cx, cy, cz);
 	float d   = sqrtf(v3dsq(vp, cc));
@@ -133,6 +166,7 @@ static bool is_chunk_occluded(vec3 vp, int cx, int cy, int cz) {
 	vec3  cc    = chunk_center(cx, cy, cz);
 	float dsq   = v3dsq(vp, cc);
 	if (dsq < MIN_OCCLUSION_DISTANCE_SQ || dsq > MAX_RENDER_DISTANCE_SQ) return false;
+	if (is_chunk_sealed(vp, cx, cy, cz)) return true;
 
 	bool  surf  = chunk_has_surface_blocks(cx, cy, cz);
 	float thr   = surf ? EDGE_VISIBILITY_THRESHOLD : VISIBILITY_THRESHOLD;
@@ -162,12 +196,8 @@ bool is_chunk_in_frustum(vec3 pos, vec3 dir, int cx, int cy, int cz, float fov_a
 	float dot = v3dot(nd, tc);
 	float ang = (CHUNK_SIZE * 0.866f) / sqrtf(dsq);
 	if (dot < fov_angle - ang) return false;
-	if (settings.occlusion_culling) {
-		pthread_mutex_lock(&chunks_mutex);
-		bool occ = is_chunk_occluded(pos, cx, cy, cz);
-		pthread_mutex_unlock(&chunks_mutex);
-		return !occ;
-	}
+	if (settings.occlusion_culling)
+		return !is_chunk_occluded(pos, cx, cy, cz);
 	return true;
 }
 
@@ -225,12 +255,20 @@ void update_frustum() {
 
 	frustum_changed = false;
 
+	int offset_x = atomic_load(&world_offset_x);
+	int offset_z = atomic_load(&world_offset_z);
 	for (int x = 0; x < rd; x++) {
+		int cx = slot_chunk_coord(x, offset_x);
 		for (int y = 0; y < WORLD_HEIGHT; y++) {
 			for (int z = 0; z < rd; z++) {
-				uint8_t vf = settings.frustum_culling
-				    ? get_visible_faces(pos, dir, world_offset_x + x, y, world_offset_z + z, fov)
-				    : ALL_FACES;
+				// Chunks with nothing uploaded (empty or enclosed) skip the
+				// frustum and occlusion tests.
+				const Chunk *c = chunks[x][y][z];
+				uint8_t vf = 0;
+				if (c->opaque_index_count || c->transparent_index_count)
+					vf = settings.frustum_culling
+					    ? get_visible_faces(pos, dir, cx, y, slot_chunk_coord(z, offset_z), fov)
+					    : ALL_FACES;
 				visibility_map[x][y][z] = vf;
 				if (!first && !frustum_changed &&
 				    prev[x * WORLD_HEIGHT * rd + y * rd + z] != vf)
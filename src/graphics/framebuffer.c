@@ -77,8 +77,9 @@ void render_to_framebuffer(void) {
 
 	char  block_face = 'N';
 	vec3  block_pos  = {0};
-	Block *block = get_targeted_block(global_entities[0], &block_pos, &block_face);
-	if (block) draw_block_highlight(block_pos, block->id);
+	Block block;
+	if (get_targeted_block(global_entities[0], &block_pos, &block_face, &block))
+		draw_block_highlight(block_pos, block.id);
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 #ifdef DEBUG
@@ -155,16 +155,10 @@ void init_cube_rendering() {
 	glGenBuffers(1, &cube_ebo);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cube_ebo);
 
-	glVertexAttribIPointer(0, 1, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, x));	   // X
+	glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(Vertex), (void*)offsetof(Vertex, position));
 	glEnableVertexAttribArray(0);
-	glVertexAttribIPointer(1, 1, GL_UNSIGNED_SHORT, sizeof(Vertex), (void*)offsetof(Vertex, y)); // Y
+	glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(Vertex), (void*)offsetof(Vertex, data));
 	glEnableVertexAttribArray(1);
-	glVertexAttribIPointer(2, 1, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, z));	   // Z
-	glEnableVertexAttribArray(2);
-	glVertexAttribIPointer(3, 1, GL_UNSIGNED_SHORT, sizeof(Vertex), (void*)offsetof(Vertex, packed_data));
-	glEnableVertexAttribArray(3);
-	glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, sizeof(Vertex), (void*)offsetof(Vertex, packed_size));
-	glEnableVertexAttribArray(4);
 	glBindVertexArray(0);
 }
 
@@ -433,16 +427,18 @@ void render_ui() {
 			int py = (int)floorf(global_entities[0].pos.y + global_entities[0].eye_level);
 			int pz = (int)floorf(global_entities[0].pos.z);
 			float best_sky = 0.0f, best_blk = 0.0f;
+			column_cursor_t cursor = COLUMN_CURSOR_INIT;
 			for (int ddx = -1; ddx <= 1; ddx++) {
 				for (int ddz = -1; ddz <= 1; ddz++) {
-					Block* pb = get_block_at(chunks, px + ddx, py, pz + ddz);
-					if (!pb) continue;
-					float s = (float)SKY_LIGHT(pb->light_level)   / 15.0f;
-					float b = (float)BLOCK_LIGHT(pb->light_level) / 15.0f;
+					Block pb;
+					if (!read_block_at(&cursor, px + ddx, py, pz + ddz, &pb)) continue;
+					float s = (float)SKY_LIGHT(pb.light_level)   / 15.0f;
+					float b = (float)BLOCK_LIGHT(pb.light_level) / 15.0f;
 					if (s > best_sky) best_sky = s;
 					if (b > best_blk) best_blk = b;
 				}
 			}
+			column_cursor_release(&cursor);
 			float sky_contrib   = best_sky * settings.sky_brightness;
 			float block_contrib = best_blk;
 			float ambient = sky_contrib > block_contrib ? sky_contrib : block_contrib;
@@ -2,6 +2,7 @@
 #include "world.h"
 #include "entity.h"
 #include "config.h"
+#include "shaders.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -21,33 +22,65 @@ uint8_t ***visibility_map = NULL;
 // Per-chunk VAO helpers
 // ---------------------------------------------------------------------------
 
-static void setup_vao_attribs(uint32_t vao, uint32_t vbo, uint32_t ebo) {
+// Every chunk draws its quads through this one index buffer, which holds
+// 0 1 2 0 2 3 for as many quads as a chunk can have.
+static uint32_t quad_ebo = 0;
+
+static uint32_t quad_index_buffer() {
+	if (quad_ebo) return quad_ebo;
+	uint32_t *indices = malloc(MESH_MAX_QUADS * 6 * sizeof(uint32_t));
+	if (!indices) {
+		fprintf(stderr, "Failed to allocate quad indices\n");
+		return 0;
+	}
+	static const uint32_t quad[6] = {0, 1, 2, 0, 2, 3};
+	for (uint32_t q = 0; q < MESH_MAX_QUADS; q++)
+		for (int i = 0; i < 6; i++)
+			indices[q * 6 + i] = q * 4 + quad[i];
+	glGenBuffers(1, &quad_ebo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, MESH_MAX_QUADS * 6 * sizeof(uint32_t), indices, GL_STATIC_DRAW);
+	free(indices);
+	return quad_ebo;
+}
+
+// Quad records feed the same two attributes once per instance, and each
+// instance draws the six corners of its quad.
+static void setup_vao_attribs(uint32_t vao, uint32_t vbo) {
 	glBindVertexArray(vao);
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glVertexAttribIPointer(0, 1, GL_INT,           sizeof(Vertex), (void*)offsetof(Vertex, x));
+	if (settings.quad_pulling) {
+		glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(quad_record_t), (void*)offsetof(quad_record_t, position));
+		glVertexAttribDivisor(0, 1);
+		glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(quad_record_t), (void*)offsetof(quad_record_t, data));
+		glVertexAttribDivisor(1, 1);
+	} else {
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_index_buffer());
+		glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(Vertex), (void*)offsetof(Vertex, position));
+		glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(Vertex), (void*)offsetof(Vertex, data));
+	}
 	glEnableVertexAttribArray(0);
-	glVertexAttribIPointer(1, 1, GL_UNSIGNED_SHORT, sizeof(Vertex), (void*)offsetof(Vertex, y));
 	glEnableVertexAttribArray(1);
-	glVertexAttribIPointer(2, 1, GL_INT,           sizeof(Vertex), (void*)offsetof(Vertex, z));
-	glEnableVertexAttribArray(2);
-	glVertexAttribIPointer(3, 1, GL_UNSIGNED_SHORT, sizeof(Vertex), (void*)offsetof(Vertex, packed_data));
-	glEnableVertexAttribArray(3);
-	glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT,   sizeof(Vertex), (void*)offsetof(Vertex, packed_size));
-	glEnableVertexAttribArray(4);
 	glBindVertexArray(0);
 }
 
+static void draw_chunk_pass(uint32_t vao, uint32_t index_count) {
+	glBindVertexArray(vao);
+	if (settings.quad_pulling)
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 6, index_count / 6);
+	else
+		glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_INT, 0);
+	draw_calls++;
+}
+
 void chunk_alloc_gpu_buffers(Chunk *chunk) {
 	if (chunk->gpu_buffers_valid) return;
 	glGenVertexArrays(1, &chunk->opaque_vao);
 	glGenBuffers(1, &chunk->opaque_vbo);
-	glGenBuffers(1, &chunk->opaque_ebo);
 	glGenVertexArrays(1, &chunk->transparent_vao);
 	glGenBuffers(1, &chunk->transparent_vbo);
-	glGenBuffers(1, &chunk->transparent_ebo);
-	setup_vao_attribs(chunk->opaque_vao,      chunk->opaque_vbo,      chunk->opaque_ebo);
-	setup_vao_attribs(chunk->transparent_vao, chunk->transparent_vbo, chunk->transparent_ebo);
+	setup_vao_attribs(chunk->opaque_vao,      chunk->opaque_vbo);
+	setup_vao_attribs(chunk->transparent_vao, chunk->transparent_vbo);
 	chunk->gpu_buffers_valid = true;
 }
 
@@ -55,71 +88,37 @@ void chunk_free_gpu_buffers(Chunk *chunk) {
 	if (!chunk->gpu_buffers_valid) return;
 	glDeleteVertexArrays(1, &chunk->opaque_vao);
 	glDeleteBuffers(1, &chunk->opaque_vbo);
-	glDeleteBuffers(1, &chunk->opaque_ebo);
 	glDeleteVertexArrays(1, &chunk->transparent_vao);
 	glDeleteBuffers(1, &chunk->transparent_vbo);
-	glDeleteBuffers(1, &chunk->transparent_ebo);
-	chunk->opaque_vao = chunk->opaque_vbo = chunk->opaque_ebo = 0;
-	chunk->transparent_vao = chunk->transparent_vbo = chunk->transparent_ebo = 0;
+	chunk->opaque_vao = chunk->opaque_vbo = 0;
+	chunk->transparent_vao = chunk->transparent_vbo = 0;
 	chunk->opaque_index_count = chunk->transparent_index_count = 0;
 	chunk->gpu_buffers_valid = false;
 }
 
-// Upload a chunk's CPU mesh (all 6 face sub-meshes merged) to its GPU buffers.
-// Must be called from the main/GL thread. Does NOT require chunks_mutex.
+// Upload a chunk's mesh block to its GPU buffers, each pass straight from the
+// block. Must be called from the main/GL thread with the chunk's column lock held.
 void chunk_upload_mesh(Chunk *chunk) {
+	const chunk_mesh_t *mesh = &chunk->mesh;
+	// Empty meshes never get GPU buffers; drawing skips them on the zero counts.
+	if (!chunk->gpu_buffers_valid && mesh->vertex_count[0] + mesh->vertex_count[1] == 0) {
+		chunk->opaque_index_count = chunk->transparent_index_count = 0;
+		return;
+	}
 	chunk_alloc_gpu_buffers(chunk);
 
-	// Merge all 6 face sub-meshes into contiguous arrays and upload.
 	for (int pass = 0; pass < 2; pass++) {
-		Mesh *faces = (pass == 0) ? chunk->faces : chunk->transparent_faces;
-		uint32_t vao = (pass == 0) ? chunk->opaque_vao      : chunk->transparent_vao;
 		uint32_t vbo = (pass == 0) ? chunk->opaque_vbo      : chunk->transparent_vbo;
-		uint32_t ebo = (pass == 0) ? chunk->opaque_ebo      : chunk->transparent_ebo;
 		uint32_t *idx_count = (pass == 0) ? &chunk->opaque_index_count : &chunk->transparent_index_count;
 
-		uint32_t total_verts = 0, total_idxs = 0;
-		for (int f = 0; f < 6; f++) {
-			total_verts += faces[f].vertex_count;
-			total_idxs  += faces[f].index_count;
-		}
-
-		*idx_count = total_idxs;
-
-		if (total_verts == 0) {
-			// Empty mesh — upload nothing but clear the buffer.
-			glBindVertexArray(vao);
-			glBindBuffer(GL_ARRAY_BUFFER, vbo);
-			glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_DYNAMIC_DRAW);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, 0, NULL, GL_DYNAMIC_DRAW);
-			continue;
-		}
-
-		Vertex   *vbuf = malloc(total_verts * sizeof(Vertex));
-		uint32_t *ibuf = malloc(total_idxs  * sizeof(uint32_t));
-		if (!vbuf || !ibuf) { free(vbuf); free(ibuf); continue; }
-
-		uint32_t vo = 0, io = 0, base = 0;
-		for (int f = 0; f < 6; f++) {
-			if (faces[f].vertex_count == 0) continue;
-			memcpy(vbuf + vo, faces[f].vertices, faces[f].vertex_count * sizeof(Vertex));
-			for (uint32_t i = 0; i < faces[f].index_count; i++)
-				ibuf[io + i] = faces[f].indices[i] + base;
-			vo   += faces[f].vertex_count;
-			io   += faces[f].index_count;
-			base += faces[f].vertex_count;
-		}
-
-		glBindVertexArray(vao);
+		// An empty pass still clears the buffer.
+		*idx_count = QUAD_INDEX_COUNT(mesh->vertex_count[pass]);
 		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, total_verts * sizeof(Vertex), vbuf, GL_DYNAMIC_DRAW);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, total_idxs * sizeof(uint32_t), ibuf, GL_DYNAMIC_DRAW);
-		free(vbuf);
-		free(ibuf);
+		if (settings.quad_pulling)
+			glBufferData(GL_ARRAY_BUFFER, mesh->vertex_count[pass] / 4 * sizeof(quad_record_t), mesh->records[pass], GL_DYNAMIC_DRAW);
+		else
+			glBufferData(GL_ARRAY_BUFFER, mesh->vertex_count[pass] * sizeof(Vertex), mesh->vertices[pass], GL_DYNAMIC_DRAW);
 	}
-	glBindVertexArray(0);
 }
 
 // ---------------------------------------------------------------------------
@@ -144,7 +143,9 @@ void init_gl_buffers() {
 
 // ---------------------------------------------------------------------------
 // Rate-limited GPU upload: max 32 dirty chunks per frame to prevent spikes
-// during world generation. Mutex held only briefly to collect dirty flags.
+// during world generation. The dirty flags are atomic, so collecting them
+// takes no locks; each upload read-locks its column, and a column a mesh job
+// holds is left for a later frame rather than waited on.
 #define MAX_UPLOADS_PER_FRAME 32
 void rebuild_combined_visible_mesh() {
 #ifdef DEBUG
@@ -154,14 +155,13 @@ void rebuild_combined_visible_mesh() {
 	static uint16_t dirty_x[4096], dirty_y[4096], dirty_z[4096];
 	int dirty_count = 0;
 
-	pthread_mutex_lock(&chunks_mutex);
+	// Cleared up front so a mesh finished during the scan requests another.
+	mesh_needs_rebuild = false;
 	for (uint8_t x = 0; x < settings.render_distance && dirty_count < 4096; x++) {
-		for (uint8_t y = 0; y < WORLD_HEIGHT && dirty_count < 4096; y++) {
-			for (uint8_t z = 0; z < settings.render_distance && dirty_count < 4096; z++) {
-				Chunk *c = &chunks[x][y][z];
+		for (uint8_t z = 0; z < settings.render_distance && dirty_count < 4096; z++) {
+			for (uint8_t y = 0; y < WORLD_HEIGHT && dirty_count < 4096; y++) {
+				Chunk *c = chunks[x][y][z];
 				if (c->is_loaded && c->mesh_dirty) {
-					if (dirty_count < MAX_UPLOADS_PER_FRAME)
-						c->mesh_dirty = false;
 					dirty_x[dirty_count] = x;
 					dirty_y[dirty_count] = y;
 					dirty_z[dirty_count] = z;
@@ -170,21 +170,24 @@ void rebuild_combined_visible_mesh() {
 			}
 		}
 	}
-	if (dirty_count > MAX_UPLOADS_PER_FRAME)
-		atomic_store(&mesh_needs_rebuild, true);
-	else
-		mesh_needs_rebuild = false;
-	pthread_mutex_unlock(&chunks_mutex);
 
-	int uploads = dirty_count < MAX_UPLOADS_PER_FRAME ? dirty_count : MAX_UPLOADS_PER_FRAME;
 #ifdef DEBUG
 	profiler_start(PROFILER_ID_UPLOAD, false);
 #endif
-	for (int i = 0; i < uploads; i++) {
-		Chunk *c = &chunks[dirty_x[i]][dirty_y[i]][dirty_z[i]];
-		if (c->is_loaded)
+	int uploads = 0;
+	for (int i = 0; i < dirty_count && uploads < MAX_UPLOADS_PER_FRAME; i++) {
+		// Mesh workers swap meshes in under the column write lock, so the
+		// flag can only be taken here while the mesh stays put.
+		if (!column_try_read_lock(dirty_x[i], dirty_z[i])) continue;
+		Chunk *c = chunks[dirty_x[i]][dirty_y[i]][dirty_z[i]];
+		if (atomic_exchange(&c->mesh_dirty, false) && c->is_loaded) {
 			chunk_upload_mesh(c);
+			uploads++;
+		}
+		column_unlock(dirty_x[i], dirty_z[i]);
 	}
+	if (uploads < dirty_count)
+		atomic_store(&mesh_needs_rebuild, true);
 #ifdef DEBUG
 	profiler_stop(PROFILER_ID_UPLOAD, false);
 #endif
@@ -203,18 +206,18 @@ void render_chunks() {
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
 	draw_calls = 0;
+	glUniform1i(quad_records_uniform_location, settings.quad_pulling);
 
 	// Opaque pass.
 	for (uint8_t x = 0; x < settings.render_distance; x++) {
 		for (uint8_t y = 0; y < WORLD_HEIGHT; y++) {
 			for (uint8_t z = 0; z < settings.render_distance; z++) {
 				if (!visibility_map[x][y][z]) continue;
-				Chunk *chunk = &chunks[x][y][z];
+				Chunk *chunk = chunks[x][y][z];
 				if (!chunk->is_loaded || !chunk->gpu_buffers_valid) continue;
 				if (chunk->opaque_index_count == 0) continue;
-				glBindVertexArray(chunk->opaque_vao);
-				glDrawElements(GL_TRIANGLES, chunk->opaque_index_count, GL_UNSIGNED_INT, 0);
-				draw_calls++;
+				glUniform3i(chunk_origin_uniform_location, chunk->x * CHUNK_SIZE, chunk->y * CHUNK_SIZE, chunk->z * CHUNK_SIZE);
+				draw_chunk_pass(chunk->opaque_vao, chunk->opaque_index_count);
 			}
 		}
 	}
@@ -234,7 +237,7 @@ void render_chunks() {
 		for (uint8_t y = 0; y < WORLD_HEIGHT; y++) {
 			for (uint8_t z = 0; z < settings.render_distance; z++) {
 				if (!visibility_map[x][y][z]) continue;
-				Chunk *chunk = &chunks[x][y][z];
+				Chunk *chunk = chunks[x][y][z];
 				if (!chunk->is_loaded || !chunk->gpu_buffers_valid) continue;
 				if (chunk->transparent_index_count == 0) continue;
 				float cx = (chunk->x + 0.5f) * CHUNK_SIZE - px;
@@ -261,11 +264,14 @@ void render_chunks() {
 	}
 
 	for (int i = 0; i < trans_count; i++) {
-		Chunk *chunk = &chunks[trans_chunks[i].x][trans_chunks[i].y][trans_chunks[i].z];
-		glBindVertexArray(chunk->transparent_vao);
-		glDrawElements(GL_TRIANGLES, chunk->transparent_index_count, GL_UNSIGNED_INT, 0);
-		draw_calls++;
+		Chunk *chunk = chunks[trans_chunks[i].x][trans_chunks[i].y][trans_chunks[i].z];
+		glUniform3i(chunk_origin_uniform_location, chunk->x * CHUNK_SIZE, chunk->y * CHUNK_SIZE, chunk->z * CHUNK_SIZE);
+		draw_chunk_pass(chunk->transparent_vao, chunk->transparent_index_count);
 	}
+	// Single-block meshes drawn with the world shader after this are placed
+	// by their model matrix alone.
+	glUniform3i(chunk_origin_uniform_location, 0, 0, 0);
+	glUniform1i(quad_records_uniform_location, 0);
 
 	if (mesh_mode)
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
@@ -276,6 +282,10 @@ void cleanup_renderer() {
 		for (int x = 0; x < settings.render_distance; x++)
 			for (int y = 0; y < WORLD_HEIGHT; y++)
 				for (int z = 0; z < settings.render_distance; z++)
-					chunk_free_gpu_buffers(&chunks[x][y][z]);
+					chunk_free_gpu_buffers(chunks[x][y][z]);
+	}
+	if (quad_ebo) {
+		glDeleteBuffers(1, &quad_ebo);
+		quad_ebo = 0;
 	}
 }
\ No newline at end of file
@@ -13,6 +13,8 @@ unsigned int projection_uniform_location       = -1;
 unsigned int ui_projection_uniform_location    = -1;
 unsigned int ui_state_uniform_location         = -1;
 unsigned int highlight_uniform_location        = -1;
+unsigned int chunk_origin_uniform_location     = -1;
+unsigned int quad_records_uniform_location     = -1;
 unsigned int screen_texture_uniform_location   = -1;
 unsigned int texture_fb_depth_uniform_location = -1;
 unsigned int far_uniform_location              = -1;
@@ -82,6 +84,8 @@ void cache_uniform_locations(void) {
 	view_uniform_location             = glGetUniformLocation(world_shader,        "view");
 	projection_uniform_location       = glGetUniformLocation(world_shader,        "projection");
 	highlight_uniform_location        = glGetUniformLocation(world_shader,        "highlight");
+	chunk_origin_uniform_location     = glGetUniformLocation(world_shader,        "chunk_origin");
+	quad_records_uniform_location     = glGetUniformLocation(world_shader,        "quad_records");
 	sky_brightness_uniform_location   = glGetUniformLocation(world_shader,        "sky_brightness");
 	ui_projection_uniform_location    = glGetUniformLocation(ui_shader,           "projection");
 	ui_state_uniform_location         = glGetUniformLocation(post_process_shader, "ui_state");
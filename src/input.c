@@ -92,8 +92,8 @@ void mouse_button_callback(GLFWwindow *win, int button, int action, int mods) {
 		} else if (button == GLFW_MOUSE_BUTTON_MIDDLE && action == GLFW_PRESS) {
 			char face;
 			vec3 pos;
-			Block *b = get_targeted_block(global_entities[0], &pos, &face);
-			if (b) { hotbar_slot = b->id - 1; update_ui(); }
+			Block b;
+			if (get_targeted_block(global_entities[0], &pos, &face, &b)) { hotbar_slot = b.id - 1; update_ui(); }
 		}
 	}
 }
@@ -162,10 +162,15 @@ void key_callback(GLFWwindow *win, int key, int scancode, int action, int mods)
 		sprint_key_held = false;
 }
 
+static void enqueue_chunk_at(int chunk_x, int chunk_y, int chunk_z) {
+	if (is_chunk_in_bounds(chunk_x, chunk_y, chunk_z))
+		enqueue_chunk_update_priority(chunk_slot(chunk_x), chunk_y, chunk_slot(chunk_z));
+}
+
 static void set_block(bool directional, uint8_t block_id) {
 	vec3 block_pos;
 	char face;
-	get_targeted_block(global_entities[0], &block_pos, &face);
+	get_targeted_block(global_entities[0], &block_pos, &face, NULL);
 
 	if (directional) {
 		switch (face) {
@@ -189,45 +194,52 @@ static void set_block(bool directional, uint8_t block_id) {
 		if (aabb_intersect(block_aabb, player_aabb)) return;
 	}
 
-	Block *block = get_block_at(chunks, block_pos.x, block_pos.y, block_pos.z);
-	if (!block) return;
-
-	uint8_t old_id = block->id;
-
 	int chunk_x, chunk_z, block_x, block_z;
 	calculate_chunk_and_block(block_pos.x, &chunk_x, &block_x);
 	calculate_chunk_and_block(block_pos.z, &chunk_z, &block_z);
 	int chunk_y = (int)block_pos.y / CHUNK_SIZE;
 	int block_y = (((int)block_pos.y % CHUNK_SIZE) + CHUNK_SIZE) % CHUNK_SIZE;
-	int lx      = chunk_x - world_offset_x;
-	int lz      = chunk_z - world_offset_z;
-	Chunk *chunk= &chunks[lx][chunk_y][lz];
+	if (!is_chunk_in_bounds(chunk_x, chunk_y, chunk_z)) return;
+
+	// Relighting reaches at most one chunk past the edited one. The main
+	// thread is the only one that scrolls, so it needs no window lock.
+	column_area_t area;
+	column_lock_area(&area, chunk_slot(chunk_x), chunk_slot(chunk_z));
+	Block block;
+	if (!get_block_at(block_pos.x, block_pos.y, block_pos.z, &block)) {
+		column_unlock_area(&area);
+		return;
+	}
+
+	uint8_t old_id = block.id;
+	Chunk *chunk= get_chunk(chunk_x, chunk_y, chunk_z);
 
-	pthread_mutex_lock(&chunks_mutex);
-	block->id = block_id;
+	chunk_set_id(chunk, block_x, block_y, block_z, block_id);
+	chunk_update_summary(chunk);
 	chunk->needs_update = true;
+	chunk->dirty = true;
 	update_block_lighting((int)block_pos.x, (int)block_pos.y, (int)block_pos.z, old_id, block_id);
-	update_adjacent_chunks(chunks, lx, chunk_y, lz, block_x, block_y, block_z);
-	pthread_mutex_unlock(&chunks_mutex);
+	update_adjacent_chunks(chunk_x, chunk_y, chunk_z, block_x, block_y, block_z);
+	column_unlock_area(&area);
 
 	// Push the edited chunk (and its affected neighbours) to the front of the
 	// mesh queue so player edits render immediately even during world generation.
-	enqueue_chunk_update_priority(lx, chunk_y, lz);
-	if (block_x == 0 && lx > 0)
-		enqueue_chunk_update_priority(lx-1, chunk_y, lz);
-	else if (block_x == CHUNK_SIZE-1 && lx < settings.render_distance-1)
-		enqueue_chunk_update_priority(lx+1, chunk_y, lz);
-	if (block_y == 0 && chunk_y > 0)
-		enqueue_chunk_update_priority(lx, chunk_y-1, lz);
-	else if (block_y == CHUNK_SIZE-1 && chunk_y < WORLD_HEIGHT-1)
-		enqueue_chunk_update_priority(lx, chunk_y+1, lz);
-	if (block_z == 0 && lz > 0)
-		enqueue_chunk_update_priority(lx, chunk_y, lz-1);
-	else if (block_z == CHUNK_SIZE-1 && lz < settings.render_distance-1)
-		enqueue_chunk_update_priority(lx, chunk_y, lz+1);
+	enqueue_chunk_at(chunk_x, chunk_y, chunk_z);
+	if (block_x == 0)
+		enqueue_chunk_at(chunk_x-1, chunk_y, chunk_z);
+	else if (block_x == CHUNK_SIZE-1)
+		enqueue_chunk_at(chunk_x+1, chunk_y, chunk_z);
+	if (block_y == 0)
+		enqueue_chunk_at(chunk_x, chunk_y-1, chunk_z);
+	else if (block_y == CHUNK_SIZE-1)
+		enqueue_chunk_at(chunk_x, chunk_y+1, chunk_z);
+	if (block_z == 0)
+		enqueue_chunk_at(chunk_x, chunk_y, chunk_z-1);
+	else if (block_z == CHUNK_SIZE-1)
+		enqueue_chunk_at(chunk_x, chunk_y, chunk_z+1);
 }
 
-void process_input(GLFWwindow *win, Chunk ***ch) {
+void process_input(GLFWwindow *win, chunk_slot_t ***ch) {
 	(void)ch;
 	if (ui_state != UI_STATE_RUNNING) return;
 
@@ -247,12 +259,9 @@ void process_input(GLFWwindow *win, Chunk ***ch) {
 	int player_cx = (int)(global_entities[0].pos.x / CHUNK_SIZE);
 	int player_cy = (int)(global_entities[0].pos.y / CHUNK_SIZE);
 	int player_cz = (int)(global_entities[0].pos.z / CHUNK_SIZE);
-	int lx        = player_cx - world_offset_x;
-	int lz        = player_cz - world_offset_z;
+	Chunk *player_chunk = get_chunk(player_cx, player_cy, player_cz);
 
-	if (player_cy > 0 && player_cy < WORLD_HEIGHT &&
-	    is_chunk_in_bounds(lx, player_cy, lz) &&
-	    !chunks[lx][player_cy][lz].is_loaded)
+	if (player_cy > 0 && player_chunk && !player_chunk->is_loaded)
 		return;
 
 	float move_speed = global_entities[0].speed;
@@ -0,0 +1,377 @@
+#include "jobs.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Shared worker pool for generation, lighting and meshing. Every worker owns
+// one deque per priority: it pushes and pops its own jobs at the back and
+// steals from the front of the others' when it runs dry. Jobs submitted from
+// outside the pool are spread round-robin. Jobs with dependencies park on the
+// first counter that is still non-zero and are re-checked when it drains, so
+// a job is only ever in one list at a time.
+// Each worker also owns a scratch arena that is emptied after every job.
+// Callers count a job as soon as job_submit_after accepts it, so once
+// accepted a job is never dropped while the pool runs: if a deque cannot
+// grow, the job goes on a shared overflow list linked through job->next.
+
+struct job {
+	job_func_t func;
+	void* arg;
+	job_priority_t priority;
+	job_counter_t* deps[JOB_MAX_DEPS];
+	int dep_count;
+	struct job* next;  // counter wait list
+};
+
+typedef struct {
+	job_t** items;
+	int head, count, capacity;
+} job_deque_t;
+
+typedef struct {
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	job_deque_t deques[JOB_PRIORITY_COUNT];
+	arena_t arena;
+	int index;
+} job_worker_t;
+
+static job_worker_t* workers = NULL;
+static int worker_count = 0;
+static _Atomic bool jobs_running = false;
+static _Atomic int jobs_queued = 0;
+static _Atomic unsigned int next_worker = 0;
+static pthread_mutex_t sleep_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sleep_cond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t overflow_mutex = PTHREAD_MUTEX_INITIALIZER;
+static job_t* overflow[JOB_PRIORITY_COUNT];
+
+// Caller holds the owning worker's mutex.
+static bool deque_push(job_deque_t* d, job_t* job) {
+	if (d->count == d->capacity) {
+		int capacity = d->capacity ? d->capacity * 2 : 64;
+		job_t** items = malloc(capacity * sizeof(job_t*));
+		if (!items) return false;
+		for (int i = 0; i < d->count; i++)
+			items[i] = d->items[(d->head + i) % d->capacity];
+		free(d->items);
+		d->items = items;
+		d->head = 0;
+		d->capacity = capacity;
+	}
+	d->items[(d->head + d->count++) % d->capacity] = job;
+	return true;
+}
+
+static job_t* deque_pop_back(job_deque_t* d) {
+	if (!d->count) return NULL;
+	return d->items[(d->head + --d->count) % d->capacity];
+}
+
+static job_t* deque_pop_front(job_deque_t* d) {
+	if (!d->count) return NULL;
+	job_t* job = d->items[d->head];
+	d->head = (d->head + 1) % d->capacity;
+	d->count--;
+	return job;
+}
+
+static int current_worker() {
+	pthread_t self = pthread_self();
+	for (int i = 0; i < worker_count; i++)
+		if (pthread_equal(workers[i].thread, self))
+			return i;
+	return -1;
+}
+
+static void push_runnable(job_t* job) {
+	// Counters can still drain after shutdown, e.g. while cancelling requests.
+	if (!atomic_load(&jobs_running)) {
+		free(job);
+		return;
+	}
+	int w = current_worker();
+	if (w < 0) w = atomic_fetch_add(&next_worker, 1) % worker_count;
+
+	pthread_mutex_lock(&workers[w].mutex);
+	bool ok = deque_push(&workers[w].deques[job->priority], job);
+	pthread_mutex_unlock(&workers[w].mutex);
+	if (!ok) {
+		pthread_mutex_lock(&overflow_mutex);
+		job->next = overflow[job->priority];
+		overflow[job->priority] = job;
+		pthread_mutex_unlock(&overflow_mutex);
+	}
+
+	atomic_fetch_add(&jobs_queued, 1);
+	pthread_mutex_lock(&sleep_mutex);
+	pthread_cond_signal(&sleep_cond);
+	pthread_mutex_unlock(&sleep_mutex);
+}
+
+// Parks the job on its first pending dependency, or queues it.
+static void schedule(job_t* job) {
+	for (int i = 0; i < job->dep_count; i++) {
+		job_counter_t* c = job->deps[i];
+		pthread_mutex_lock(&c->mutex);
+		if (c->value > 0) {
+			job->next = c->waiting;
+			c->waiting = job;
+			pthread_mutex_unlock(&c->mutex);
+			return;
+		}
+		pthread_mutex_unlock(&c->mutex);
+	}
+	push_runnable(job);
+}
+
+static job_t* pop_overflow(int p) {
+	pthread_mutex_lock(&overflow_mutex);
+	job_t* job = overflow[p];
+	if (job) overflow[p] = job->next;
+	pthread_mutex_unlock(&overflow_mutex);
+	return job;
+}
+
+// Own deque first, then steal, then overflow, most urgent priority first.
+static job_t* find_job(job_worker_t* self) {
+	for (int p = 0; p < JOB_PRIORITY_COUNT; p++) {
+		pthread_mutex_lock(&self->mutex);
+		job_t* job = deque_pop_back(&self->deques[p]);
+		pthread_mutex_unlock(&self->mutex);
+		for (int i = 1; !job && i < worker_count; i++) {
+			job_worker_t* victim = &workers[(self->index + i) % worker_count];
+			pthread_mutex_lock(&victim->mutex);
+			job = deque_pop_front(&victim->deques[p]);
+			pthread_mutex_unlock(&victim->mutex);
+		}
+		if (!job) job = pop_overflow(p);
+		if (job) {
+			atomic_fetch_sub(&jobs_queued, 1);
+			return job;
+		}
+	}
+	return NULL;
+}
+
+static void* worker_func(void* arg) {
+	job_worker_t* self = arg;
+	// jobs_init holds sleep_mutex until every worker is registered.
+	pthread_mutex_lock(&sleep_mutex);
+	pthread_mutex_unlock(&sleep_mutex);
+	while (atomic_load(&jobs_running)) {
+		job_t* job = find_job(self);
+		if (!job) {
+			pthread_mutex_lock(&sleep_mutex);
+			while (atomic_load(&jobs_queued) == 0 && atomic_load(&jobs_running))
+				pthread_cond_wait(&sleep_cond, &sleep_mutex);
+			pthread_mutex_unlock(&sleep_mutex);
+			continue;
+		}
+		job->func(job->arg, self->index);
+		self->arena.used = 0;
+		free(job);
+	}
+	return NULL;
+}
+
+// thread_count <= 0 picks one worker per core, leaving one for the main thread.
+bool jobs_init(int thread_count) {
+	if (atomic_load(&jobs_running)) return true;
+
+	if (thread_count <= 0) {
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		thread_count = cores > 1 ? (int)cores - 1 : 1;
+	}
+	if (thread_count > MAX_WORKER_THREADS) thread_count = MAX_WORKER_THREADS;
+
+	workers = calloc(thread_count, sizeof(job_worker_t));
+	if (!workers) return false;
+	for (int i = 0; i < thread_count; i++) {
+		pthread_mutex_init(&workers[i].mutex, NULL);
+		workers[i].index = i;
+		// Without an arena the worker's jobs fall back to the heap.
+		workers[i].arena.base = malloc(JOB_ARENA_SIZE);
+		workers[i].arena.size = workers[i].arena.base ? JOB_ARENA_SIZE : 0;
+	}
+
+	// Workers look themselves up by thread id, so all ids must be in place
+	// before any of them starts.
+	atomic_store(&jobs_running, true);
+	pthread_mutex_lock(&sleep_mutex);
+	int created = 0;
+	for (; created < thread_count; created++) {
+		int result = pthread_create(&workers[created].thread, NULL, worker_func, &workers[created]);
+		if (result != 0) {
+			fprintf(stderr, "Failed to create worker thread %d: %s\n", created, strerror(result));
+			break;
+		}
+	}
+	worker_count = created;
+	pthread_mutex_unlock(&sleep_mutex);
+
+	for (int i = created; i < thread_count; i++)
+		free(workers[i].arena.base);
+	if (worker_count == 0) {
+		atomic_store(&jobs_running, false);
+		free(workers);
+		workers = NULL;
+		return false;
+	}
+	return true;
+}
+
+// Waits for running jobs to return and drops everything still queued. Jobs
+// parked on counters are dropped by job_counter_destroy.
+void jobs_shutdown() {
+	if (!atomic_load(&jobs_running)) return;
+
+	pthread_mutex_lock(&sleep_mutex);
+	atomic_store(&jobs_running, false);
+	pthread_cond_broadcast(&sleep_cond);
+	pthread_mutex_unlock(&sleep_mutex);
+
+	for (int i = 0; i < worker_count; i++) {
+		int result = pthread_join(workers[i].thread, NULL);
+		if (result != 0)
+			fprintf(stderr, "Failed to join worker thread %d: %s\n", i, strerror(result));
+	}
+	for (int i = 0; i < worker_count; i++) {
+		for (int p = 0; p < JOB_PRIORITY_COUNT; p++) {
+			job_t* job;
+			while ((job = deque_pop_front(&workers[i].deques[p])))
+				free(job);
+			free(workers[i].deques[p].items);
+		}
+		pthread_mutex_destroy(&workers[i].mutex);
+		free(workers[i].arena.base);
+	}
+	for (int p = 0; p < JOB_PRIORITY_COUNT; p++) {
+		job_t* job;
+		while ((job = pop_overflow(p)))
+			free(job);
+	}
+	free(workers);
+	workers = NULL;
+	worker_count = 0;
+	atomic_store(&jobs_queued, 0);
+}
+
+int jobs_thread_count() {
+	return worker_count;
+}
+
+// Only the worker itself may use its arena, and only while running a job.
+arena_t* job_arena(int worker) {
+	return worker >= 0 && worker < worker_count ? &workers[worker].arena : NULL;
+}
+
+#define ARENA_ALIGN(size) (((size) + 15) & ~(size_t)15)
+
+// Returns NULL once the arena is full; callers fall back to the heap.
+void* arena_alloc(arena_t* arena, size_t size) {
+	size = ARENA_ALIGN(size);
+	if (!arena || arena->size - arena->used < size) return NULL;
+	void* p = arena->base + arena->used;
+	arena->used += size;
+	return p;
+}
+
+// Grows p, of size bytes, to new_size in place. Only the most recent
+// allocation can grow, and only while the arena has room.
+bool arena_extend(arena_t* arena, void* p, size_t size, size_t new_size) {
+	if (!arena || (uint8_t*)p + ARENA_ALIGN(size) != arena->base + arena->used) return false;
+	size_t start = (uint8_t*)p - arena->base;
+	if (arena->size - start < ARENA_ALIGN(new_size)) return false;
+	arena->used = start + ARENA_ALIGN(new_size);
+	return true;
+}
+
+// Gives p back if it is the most recent allocation; anything older stays
+// until the arena is released past it.
+void arena_pop(arena_t* arena, void* p, size_t size) {
+	if (arena && (uint8_t*)p + ARENA_ALIGN(size) == arena->base + arena->used)
+		arena->used = (uint8_t*)p - arena->base;
+}
+
+// Marks and releases let one job reuse its arena for several passes.
+size_t arena_mark(const arena_t* arena) {
+	return arena ? arena->used : 0;
+}
+
+void arena_release(arena_t* arena, size_t mark) {
+	if (arena && mark <= arena->used) arena->used = mark;
+}
+
+void job_counter_init(job_counter_t* counter) {
+	counter->value = 0;
+	counter->waiting = NULL;
+	pthread_mutex_init(&counter->mutex, NULL);
+}
+
+void job_counter_destroy(job_counter_t* counter) {
+	job_t* job = counter->waiting;
+	while (job) {
+		job_t* next = job->next;
+		free(job);
+		job = next;
+	}
+	counter->waiting = NULL;
+	pthread_mutex_destroy(&counter->mutex);
+}
+
+void job_counter_add(job_counter_t* counter, int amount) {
+	pthread_mutex_lock(&counter->mutex);
+	counter->value += amount;
+	pthread_mutex_unlock(&counter->mutex);
+}
+
+// Once the counter drains, the jobs waiting on it move on to their next
+// pending dependency or become runnable.
+void job_counter_done(job_counter_t* counter) {
+	pthread_mutex_lock(&counter->mutex);
+	job_t* released = NULL;
+	if (--counter->value == 0) {
+		released = counter->waiting;
+		counter->waiting = NULL;
+	}
+	pthread_mutex_unlock(&counter->mutex);
+
+	while (released) {
+		job_t* next = released->next;
+		schedule(released);
+		released = next;
+	}
+}
+
+bool job_submit(job_func_t func, void* arg, job_priority_t priority) {
+	return job_submit_after(func, arg, priority, NULL, 0);
+}
+
+// Returns false if the job was not accepted: the pool is down, it waits on
+// more than JOB_MAX_DEPS counters, or it could not be allocated. Callers
+// undo whatever they counted for it.
+bool job_submit_after(job_func_t func, void* arg, job_priority_t priority,
+                      job_counter_t* const* deps, int dep_count) {
+	if (!atomic_load(&jobs_running)) return false;
+	if (dep_count < 0 || dep_count > JOB_MAX_DEPS) {
+		fprintf(stderr, "Job waits on %d counters, at most %d are supported\n", dep_count, JOB_MAX_DEPS);
+		return false;
+	}
+	job_t* job = malloc(sizeof(job_t));
+	if (!job) {
+		fprintf(stderr, "Failed to allocate job\n");
+		return false;
+	}
+	job->func = func;
+	job->arg = arg;
+	job->priority = priority;
+	job->dep_count = dep_count;
+	for (int i = 0; i < dep_count; i++)
+		job->deps[i] = deps[i];
+	job->next = NULL;
+	schedule(job);
+	return true;
+}
@@ -2,6 +2,8 @@
 #include "config.h"
 #include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
+#include <pthread.h>
 
 static const face_vertex_t cube_faces[6][4] = {
 	{{{1,1,1},{1,0}},{{0,1,1},{0,0}},{{0,0,1},{0,1}},{{1,0,1},{1,1}}},
@@ -30,27 +32,14 @@ static const face_vertex_t cross_faces[4][4] = {
 
 static const uint32_t quad_indices[6] = {0, 1, 2, 0, 2, 3};
 
-void add_quad(Chunk *chunk, float x, float y, float z, uint8_t normal, uint8_t texture_id,
+void add_quad(bool is_liquid, float x, float y, float z, uint8_t normal, uint8_t texture_id,
               const face_vertex_t face_data[4], uint8_t width, uint8_t height,
               uint8_t sky_light, uint8_t block_light,
-              Vertex vertices[], uint32_t indices[],
-              uint32_t *vertex_count, uint32_t *index_count) {
-	uint32_t base = *vertex_count;
-
+              Vertex vertices[], uint32_t *vertex_count) {
 	float wb = (normal == 1 || normal == 3) ? 1.0f : (float)width;
 	float hb = (normal >= 4)               ? 1.0f : (float)height;
 	float db = (normal == 0 || normal == 2) ? 1.0f : (normal >= 4 ? (float)height : (float)width);
 
-	uint8_t block_id = 0;
-	if (chunk) {
-		uint8_t lx = (uint8_t)(x - chunk->x * CHUNK_SIZE);
-		uint8_t ly = (uint8_t)(y - chunk->y * CHUNK_SIZE);
-		uint8_t lz = (uint8_t)(z - chunk->z * CHUNK_SIZE);
-		if (lx < CHUNK_SIZE && ly < CHUNK_SIZE && lz < CHUNK_SIZE)
-			block_id = chunk->blocks[lx][ly][lz].id;
-	}
-
-	bool    is_liquid        = block_data[block_id][0] == BTYPE_LIQUID;
 	float   liquid_adj       = is_liquid ? 0.125f : 0.0f;
 
 	for (int i = 0; i < 4; i++) {
@@ -88,19 +77,14 @@ void add_quad(Chunk *chunk, float x, float y, float z, uint8_t normal, uint8_t t
 		}
 
 		vertices[(*vertex_count)++] = (Vertex){
-			(int32_t)(px * 16.0f),
-			(uint16_t)(py * 16.0f),
-			(int32_t)(pz * 16.0f),
-			PACK_VERTEX_DATA(normal, texture_id),
-			(uint32_t)((uint32_t)(uu * 16)        & 0x1FF)
-			| (uint32_t)(((uint32_t)(uv * 16)     & 0x1FF) << 9)
-			| (uint32_t)((sky_light   & 0xF)               << 18)
-			| (uint32_t)((block_light & 0xF)               << 22)
+			PACK_VERTEX_POSITION((uint32_t)(px * 16.0f) & 0x1FF,
+			                     (uint32_t)(py * 16.0f) & 0x1FF,
+			                     (uint32_t)(pz * 16.0f) & 0x1FF, normal),
+			PACK_VERTEX_DATA(texture_id,
+			                 (uint32_t)(uu * 2) & 0x3F, (uint32_t)(uv * 2) & 0x3F,
+			                 sky_light & 0xF, block_light & 0xF)
 		};
 	}
-
-	for (int i = 0; i < 6; i++)
-		indices[(*index_count)++] = base + quad_indices[i];
 }
 
 void clear_face_data(Mesh faces[6]) {
@@ -112,7 +96,7 @@ void clear_face_data(Mesh faces[6]) {
 	}
 }
 
-void store_face_data(Mesh *m, Vertex *verts, uint32_t *idxs,
+void store_face_data(Mesh *m, const Vertex *verts, const uint32_t *idxs,
                      uint32_t vc, uint32_t ic) {
 	if (vc == 0) return;
 	Vertex   *vb = malloc(vc * sizeof(Vertex));
@@ -132,151 +116,263 @@ void generate_single_block_mesh(float x, float y, float z, uint8_t block_id, Mes
 	if (bt == BTYPE_REGULAR || bt == BTYPE_SLAB || bt == BTYPE_LIQUID || bt == BTYPE_LEAF) {
 		const face_vertex_t (*fd)[4] = (bt == BTYPE_SLAB) ? slab_faces : cube_faces;
 		for (int f = 0; f < 6; f++) {
-			Vertex v[4]; uint32_t idx[6];
-			uint32_t vc = 0, ic = 0;
-			add_quad(NULL, x, y, z, f, block_data[block_id][2+f], fd[f], 1, 1,
-			         15, 0, v, idx, &vc, &ic);
-			store_face_data(&faces[f], v, idx, vc, ic);
+			Vertex v[4];
+			uint32_t vc = 0;
+			add_quad(false, x, y, z, f, block_data[block_id][2+f], fd[f], 1, 1,
+			         15, 0, v, &vc);
+			store_face_data(&faces[f], v, quad_indices, vc, 6);
 		}
 	} else if (bt == BTYPE_CROSS) {
 		for (int f = 0; f < 4; f++) {
-			Vertex v[4]; uint32_t idx[6];
-			uint32_t vc = 0, ic = 0;
-			add_quad(NULL, x, y, z, f, block_data[block_id][2+f], cross_faces[f], 1, 1,
-			         15, 0, v, idx, &vc, &ic);
-			store_face_data(&faces[f], v, idx, vc, ic);
+			Vertex v[4];
+			uint32_t vc = 0;
+			add_quad(false, x, y, z, f, block_data[block_id][2+f], cross_faces[f], 1, 1,
+			         15, 0, v, &vc);
+			store_face_data(&faces[f], v, quad_indices, vc, 6);
+		}
+	}
+}
+
+// Indexed by mesh_quad_t shape.
+static const face_vertex_t (*const shape_faces[])[4] = { cube_faces, slab_faces, cross_faces };
+
+// Chunk meshes live in power-of-two blocks from 4 KB up, recycled through one
+// free list per size. At most MESH_POOL_MAX_BYTES are kept free, the rest goes
+// back to the heap.
+#define MESH_BLOCK_MIN_SHIFT 12
+#define MESH_BLOCK_CLASSES   11
+#define MESH_POOL_MAX_BYTES  ((size_t)64 << 20)
+
+typedef struct mesh_free_block {
+	struct mesh_free_block *next;
+} mesh_free_block_t;
+
+static mesh_free_block_t *mesh_pool[MESH_BLOCK_CLASSES];
+static size_t mesh_pool_bytes = 0;
+static pthread_mutex_t mesh_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void *mesh_block_alloc(size_t size, uint32_t *capacity) {
+	int c = 0;
+	while (c < MESH_BLOCK_CLASSES && ((size_t)1 << (MESH_BLOCK_MIN_SHIFT + c)) < size) c++;
+	if (c == MESH_BLOCK_CLASSES) {
+		*capacity = (uint32_t)size;
+		return malloc(size);
+	}
+	*capacity = (uint32_t)1 << (MESH_BLOCK_MIN_SHIFT + c);
+
+	pthread_mutex_lock(&mesh_pool_mutex);
+	mesh_free_block_t *block = mesh_pool[c];
+	if (block) {
+		mesh_pool[c] = block->next;
+		mesh_pool_bytes -= *capacity;
+	}
+	pthread_mutex_unlock(&mesh_pool_mutex);
+	return block ? (void *)block : malloc(*capacity);
+}
+
+void chunk_mesh_free(chunk_mesh_t *mesh) {
+	void *block = mesh->block;
+	uint32_t size = mesh->block_size;
+	memset(mesh, 0, sizeof(*mesh));
+	if (!block) return;
+
+	// Only blocks of exactly a class size came from the pool.
+	int c = __builtin_ctz(size) - MESH_BLOCK_MIN_SHIFT;
+	if ((size & (size - 1)) == 0 && c >= 0 && c < MESH_BLOCK_CLASSES) {
+		pthread_mutex_lock(&mesh_pool_mutex);
+		bool keep = mesh_pool_bytes + size <= MESH_POOL_MAX_BYTES;
+		if (keep) {
+			mesh_free_block_t *free_block = block;
+			free_block->next = mesh_pool[c];
+			mesh_pool[c] = free_block;
+			mesh_pool_bytes += size;
 		}
+		pthread_mutex_unlock(&mesh_pool_mutex);
+		if (keep) return;
 	}
+	free(block);
 }
 
-static bool append_quad_to_mesh(Mesh *m, Chunk *chunk,
-                                 float wx, float wy, float wz,
-                                 uint8_t face, uint8_t texture_id,
-                                 const face_vertex_t *fd,
-                                 uint8_t sky_light, uint8_t block_light) {
-	uint32_t bv = m->vertex_count;
-	uint32_t bi = m->index_count;
-	Vertex   *nv = realloc(m->vertices, (bv + 4) * sizeof(Vertex));
-	uint32_t *ni = realloc(m->indices,  (bi + 6) * sizeof(uint32_t));
-	if (!nv || !ni) {
-		// On partial failure, restore whichever pointer realloc didn't touch.
-		if (nv) m->vertices = nv;
-		if (ni) m->indices  = ni;
+// Call once no chunk holds a mesh any more.
+void mesh_block_pool_clear() {
+	pthread_mutex_lock(&mesh_pool_mutex);
+	for (int c = 0; c < MESH_BLOCK_CLASSES; c++) {
+		while (mesh_pool[c]) {
+			mesh_free_block_t *next = mesh_pool[c]->next;
+			free(mesh_pool[c]);
+			mesh_pool[c] = next;
+		}
+	}
+	mesh_pool_bytes = 0;
+	pthread_mutex_unlock(&mesh_pool_mutex);
+}
+
+bool mesh_scratch_init(mesh_scratch_t *s) {
+	s->quads[0] = malloc(MESH_MAX_QUADS * sizeof(mesh_quad_t));
+	s->quads[1] = malloc(MESH_MAX_QUADS * sizeof(mesh_quad_t));
+	if (!s->quads[0] || !s->quads[1]) {
+		mesh_scratch_free(s);
 		return false;
 	}
-	m->vertices = nv;
-	m->indices  = ni;
-
-	Vertex   tv[4];
-	uint32_t ti[6];
-	uint32_t vc = 0, ic = 0;
-	add_quad(chunk, wx, wy, wz, face, texture_id, fd, 1, 1,
-	         sky_light, block_light, tv, ti, &vc, &ic);
-	memcpy(m->vertices + bv, tv, 4 * sizeof(Vertex));
-	for (int i = 0; i < 6; i++) m->indices[bi + i] = ti[i] + bv;
-	m->vertex_count += 4;
-	m->index_count  += 6;
 	return true;
 }
 
-void generate_chunk_mesh(Chunk *chunk) {
-	if (!chunk) return;
+void mesh_scratch_free(mesh_scratch_t *s) {
+	free(s->quads[0]); s->quads[0] = NULL;
+	free(s->quads[1]); s->quads[1] = NULL;
+}
+
+// Quads are collected face by face, each face's greedy quads followed by its
+// slab and cross quads, then written in one go into a block sized for them.
+void generate_chunk_mesh(mesh_scratch_t *scratch, chunk_mesh_t *out) {
+	memset(out, 0, sizeof(*out));
+	if (!scratch) return;
 
-	clear_face_data(chunk->faces);
-	clear_face_data(chunk->transparent_faces);
+	const chunk_snapshot_t *snap = &scratch->snapshot;
 
-	float wx0 = chunk->x * CHUNK_SIZE;
-	float wy0 = chunk->y * CHUNK_SIZE;
-	float wz0 = chunk->z * CHUNK_SIZE;
+	face_masks_t masks;
+	build_face_masks(snap, &masks);
 
-	bool mask[CHUNK_SIZE][CHUNK_SIZE];
+	// Slab and cross blocks, packed x << 8 | y << 4 | z.
+	uint16_t specials[CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE];
+	int special_count = 0;
+	for (int x = 0; x < CHUNK_SIZE; x++)
+		for (int y = 0; y < CHUNK_SIZE; y++)
+			for (int z = 0; z < CHUNK_SIZE; z++) {
+				uint8_t bt = block_data[snap->id[x + 1][y + 1][z + 1]][0];
+				if (snap->id[x + 1][y + 1][z + 1] && (bt == BTYPE_SLAB || bt == BTYPE_CROSS))
+					specials[special_count++] = (uint16_t)(x << 8 | y << 4 | z);
+			}
 
-	Vertex   *fv  = malloc((MAX_VERTICES / 6) * sizeof(Vertex));
-	uint32_t *fi  = malloc((MAX_VERTICES / 6) * sizeof(uint32_t));
-	Vertex   *tv  = malloc((MAX_VERTICES / 6) * sizeof(Vertex));
-	uint32_t *ti  = malloc((MAX_VERTICES / 6) * sizeof(uint32_t));
-	if (!fv || !fi || !tv || !ti) {
-		free(fv); free(fi); free(tv); free(ti);
-		return;
-	}
+	uint32_t quad_count[2] = { 0, 0 };
+	uint32_t face_quads[2][6];
 
 	for (int face = 0; face < 6; face++) {
-		uint32_t fvc = 0, fic = 0, tvc = 0, tic = 0;
+		uint32_t start[2] = { quad_count[0], quad_count[1] };
 
 		for (int d = 0; d < CHUNK_SIZE; d++) {
-			memset(mask, 0, sizeof(mask));
+			// Faces still waiting for a quad in this slice, one row per v.
+			uint16_t *open = masks.rows[face][d];
+			uint16_t any = 0;
+			for (int v = 0; v < CHUNK_SIZE; v++) any |= open[v];
+			if (!any) continue;
+
+			// Faces merge when block id and face light match. Key them as
+			// id << 8 | light; same_u[v] bit u says face u matches face
+			// u + 1, same_v[v] bit u that row v matches row v + 1 there.
+			uint16_t key[CHUNK_SIZE][CHUNK_SIZE];
+			uint16_t same_u[CHUNK_SIZE] = {0}, same_v[CHUNK_SIZE] = {0};
+			memset(key, 0, sizeof(key));
+			for (int v = 0; v < CHUNK_SIZE; v++)
+				for (uint16_t bits = open[v]; bits; bits &= bits - 1) {
+					int u = __builtin_ctz(bits);
+					uint8_t x, y, z;
+					map_coordinates(face, u, v, d, &x, &y, &z);
+					uint16_t k = (uint16_t)(snap->id[x + 1][y + 1][z + 1] << 8 | get_face_light(snap, x, y, z, face));
+					key[v][u] = k;
+					if (u > 0) same_u[v]     |= (uint16_t)((key[v][u - 1] == k) << (u - 1));
+					if (v > 0) same_v[v - 1] |= (uint16_t)((key[v - 1][u] == k) << u);
+				}
 
 			for (int v = 0; v < CHUNK_SIZE; v++) {
-				for (int u = 0; u < CHUNK_SIZE; u++) {
-					if (mask[v][u]) continue;
+				while (open[v]) {
+					int u = __builtin_ctz(open[v]);
 
 					uint8_t x, y, z;
 					map_coordinates(face, u, v, d, &x, &y, &z);
-					if (x >= CHUNK_SIZE || y >= CHUNK_SIZE || z >= CHUNK_SIZE) continue;
-
-					Block *blk = &chunk->blocks[x][y][z];
-					if (!blk->id) continue;
-					uint8_t bt = block_data[blk->id][0];
-					if (bt != BTYPE_REGULAR && bt != BTYPE_LIQUID && bt != BTYPE_LEAF) continue;
-					if (!(bt == BTYPE_LEAF && settings.fancy_graphics) &&
-					    !is_face_visible(chunk, x, y, z, face)) continue;
-
-					uint8_t w = find_width(chunk,  face, u, v, x, y, z, mask, blk);
-					uint8_t h = find_height(chunk, face, u, v, x, y, z, mask, blk, w);
-
-					for (int dy = 0; dy < h && v + dy < CHUNK_SIZE; dy++) {
-						int end = u + w < CHUNK_SIZE ? u + w : CHUNK_SIZE;
-						memset(&mask[v + dy][u], true, (end - u) * sizeof(bool));
-					}
-
-					uint8_t pl  = get_face_light(chunk, x, y, z, face);
-					uint8_t sl  = (pl >> 4) & 0xF;
-					uint8_t bl2 = pl & 0xF;
-					uint8_t tid = block_data[blk->id][2 + face];
-					bool    trans = block_data[blk->id][1] != 0;
-
-					if (trans)
-						add_quad(chunk, x + wx0, y + wy0, z + wz0, face, tid,
-						         cube_faces[face], w, h, sl, bl2, tv, ti, &tvc, &tic);
-					else
-						add_quad(chunk, x + wx0, y + wy0, z + wz0, face, tid,
-						         cube_faces[face], w, h, sl, bl2, fv, fi, &fvc, &fic);
+					uint8_t id = key[v][u] >> 8;
+					uint8_t pl = key[v][u] & 0xFF;
+
+					// Extend along u while the faces match the first one:
+					// bit k of run is face u + 1 + k, open and equal to its
+					// left neighbour.
+					uint32_t run = (uint32_t)(open[v] & (same_u[v] << 1)) >> (u + 1);
+					int w = 1 + __builtin_ctz(~run);
+					uint16_t span = (uint16_t)(((1u << w) - 1) << u);
+
+					// Then along v while the whole span is open and equal to
+					// the row before it.
+					int h = 1;
+					while (v + h < CHUNK_SIZE && (open[v + h] & same_v[v + h - 1] & span) == span)
+						h++;
+
+					for (int dv = 0; dv < h; dv++)
+						open[v + dv] &= ~span;
+
+					int pass = block_data[id][1] != 0;
+					scratch->quads[pass][quad_count[pass]++] = (mesh_quad_t){
+						x, y, z, face, block_data[id][2 + face], w, h, pl,
+						QUAD_CUBE, block_data[id][0] == BTYPE_LIQUID
+					};
 				}
 			}
 		}
 
-		store_face_data(&chunk->faces[face],             fv, fi, fvc, fic);
-		store_face_data(&chunk->transparent_faces[face], tv, ti, tvc, tic);
-		fvc = fic = tvc = tic = 0;
+		for (int i = 0; i < special_count; i++) {
+			uint8_t x = specials[i] >> 8, y = (specials[i] >> 4) & 0xF, z = specials[i] & 0xF;
+			uint8_t id = snap->id[x + 1][y + 1][z + 1];
+			bool cross = block_data[id][0] == BTYPE_CROSS;
+			if (cross && face >= 4) continue;
+
+			int pass = block_data[id][1] != 0;
+			scratch->quads[pass][quad_count[pass]++] = (mesh_quad_t){
+				x, y, z, face, block_data[id][2 + face], 1, 1, snap->light[x + 1][y + 1][z + 1],
+				cross ? QUAD_CROSS : QUAD_SLAB, false
+			};
+		}
+
+		face_quads[0][face] = quad_count[0] - start[0];
+		face_quads[1][face] = quad_count[1] - start[1];
 	}
 
-	for (int x = 0; x < CHUNK_SIZE; x++) {
-		for (int y = 0; y < CHUNK_SIZE; y++) {
-			for (int z = 0; z < CHUNK_SIZE; z++) {
-				Block *blk = &chunk->blocks[x][y][z];
-				if (!blk->id) continue;
-				uint8_t bt = block_data[blk->id][0];
-				if (bt != BTYPE_SLAB && bt != BTYPE_CROSS) continue;
-
-				bool   trans       = block_data[blk->id][1] != 0;
-				Mesh  *tgt         = trans ? chunk->transparent_faces : chunk->faces;
-				int    face_count  = (bt == BTYPE_CROSS) ? 4 : 6;
-				uint8_t pl  = blk->light_level;
-				uint8_t sl  = (pl >> 4) & 0xF;
-				uint8_t bl2 = pl & 0xF;
-
-				for (int f = 0; f < face_count; f++) {
-					const face_vertex_t *fd = (bt == BTYPE_CROSS) ? cross_faces[f]
-					                        : (bt == BTYPE_SLAB)  ? slab_faces[f]
-					                                               : cube_faces[f];
-					append_quad_to_mesh(&tgt[f], chunk,
-					                    x + wx0, y + wy0, z + wz0,
-					                    f, block_data[blk->id][2 + f], fd, sl, bl2);
-				}
+	size_t total = quad_count[0] + quad_count[1];
+	if (total == 0) return;
+	bool records = settings.quad_pulling;
+	out->block = mesh_block_alloc(records ? total * sizeof(quad_record_t) : total * 4 * sizeof(Vertex),
+	                              &out->block_size);
+	if (!out->block) {
+		fprintf(stderr, "Failed to allocate chunk mesh\n");
+		return;
+	}
+
+	if (records) {
+		quad_record_t *record = out->block;
+		for (int pass = 0; pass < 2; pass++) {
+			const mesh_quad_t *q = scratch->quads[pass];
+			uint32_t first = 0;
+			out->records[pass] = record;
+			for (int face = 0; face < 6; face++) {
+				out->faces[pass][face].first_vertex = first * 4;
+				out->faces[pass][face].vertex_count = (uint16_t)(face_quads[pass][face] * 4);
+				first += face_quads[pass][face];
 			}
+			for (uint32_t i = 0; i < quad_count[pass]; i++, q++)
+				*record++ = (quad_record_t){
+					PACK_QUAD_POSITION(q->x, q->y, q->z, q->width, q->height, q->face, q->shape, q->liquid),
+					PACK_VERTEX_DATA(q->texture_id, 0, 0, SKY_LIGHT(q->light), BLOCK_LIGHT(q->light))
+				};
+			out->vertex_count[pass] = quad_count[pass] * 4;
 		}
+		return;
 	}
 
-	free(fv); free(fi); free(tv); free(ti);
-	chunk->needs_update = false;
+	// Positions stay chunk-local; the renderer places the chunk.
+	Vertex *vertices = out->block;
+	for (int pass = 0; pass < 2; pass++) {
+		const mesh_quad_t *q = scratch->quads[pass];
+		uint32_t vc = 0;
+		out->vertices[pass] = vertices;
+		for (int face = 0; face < 6; face++) {
+			mesh_range_t *range = &out->faces[pass][face];
+			range->first_vertex = vc;
+			for (uint32_t i = 0; i < face_quads[pass][face]; i++, q++)
+				add_quad(q->liquid, q->x, q->y, q->z, q->face, q->texture_id,
+				         shape_faces[q->shape][q->face], q->width, q->height,
+				         SKY_LIGHT(q->light), BLOCK_LIGHT(q->light),
+				         vertices, &vc);
+			range->vertex_count = (uint16_t)(vc - range->first_vertex);
+		}
+		out->vertex_count[pass] = vc;
+		vertices += vc;
+	}
 }
@@ -8,13 +8,6 @@
 
 #define MAX_LIGHT_LEVEL 15
 
-static uint8_t get_block_emission(uint8_t id) {
-	switch (id) {
-		case 10: case 11: case 89: return 15;
-		default: return 0;
-	}
-}
-
 static uint8_t get_sky_opacity(uint8_t id) {
 	if (id == 0) return 0;
 	if (block_data[id][1] == 0) return 15;
@@ -35,66 +28,85 @@ static uint8_t get_block_opacity(uint8_t id) {
 	}
 }
 
-static bool world_to_chunk(int wx, int wy, int wz,
-                            int *ci_x, int *ci_y, int *ci_z,
-                            int *lx,   int *ly,   int *lz) {
+static Chunk* world_to_chunk(int wx, int wy, int wz, int *lx, int *ly, int *lz) {
 	int cx = (wx < 0) ? ((wx + 1) / CHUNK_SIZE - 1) : (wx / CHUNK_SIZE);
 	int cy =  wy / CHUNK_SIZE;
 	int cz = (wz < 0) ? ((wz + 1) / CHUNK_SIZE - 1) : (wz / CHUNK_SIZE);
 
-	*ci_x = cx - (int)atomic_load(&world_offset_x);
-	*ci_y = cy;
-	*ci_z = cz - (int)atomic_load(&world_offset_z);
-
-	if (*ci_x < 0 || *ci_x >= settings.render_distance) return false;
-	if (*ci_y < 0 || *ci_y >= WORLD_HEIGHT)              return false;
-	if (*ci_z < 0 || *ci_z >= settings.render_distance) return false;
-
 	*lx = ((wx % CHUNK_SIZE) + CHUNK_SIZE) % CHUNK_SIZE;
 	*ly = ((wy % CHUNK_SIZE) + CHUNK_SIZE) % CHUNK_SIZE;
 	*lz = ((wz % CHUNK_SIZE) + CHUNK_SIZE) % CHUNK_SIZE;
-	return true;
+	return get_chunk(cx, cy, cz);
 }
 
-static uint8_t get_light(int wx, int wy, int wz) {
-	int ci_x, ci_y, ci_z, lx, ly, lz;
-	if (!world_to_chunk(wx, wy, wz, &ci_x, &ci_y, &ci_z, &lx, &ly, &lz)) return 0;
-	Chunk *c = &chunks[ci_x][ci_y][ci_z];
-	return c->is_loaded ? c->blocks[lx][ly][lz].light_level : 0;
+// The BFS below walks chunk-local nodes: pos packs x << 8 | y << 4 | z like
+// structure_cell_t, and chunk indexes the chunks the walk has reached so far.
+// Only a step across a chunk border looks up the neighbouring chunk, once per
+// chunk and face; index 0 stands for an unloaded or missing chunk.
+#define LIGHT_POS(x, y, z) ((uint16_t)((x) << 8 | (y) << 4 | (z)))
+#define LIGHT_POS_X(p) ((p) >> 8)
+#define LIGHT_POS_Y(p) (((p) >> 4) & 0xF)
+#define LIGHT_POS_Z(p) ((p) & 0xF)
+#define LIGHT_NO_CHUNK 0
+#define LIGHT_UNRESOLVED 0xFF
+#define LIGHT_AREA_CHUNKS 255
+#define LIGHT_DOWN 3
+
+// Light never travels a whole chunk sideways, so a walk stays within the 3x3
+// columns around the chunk it starts in.
+#if 9 * WORLD_HEIGHT >= LIGHT_AREA_CHUNKS
+#error "light_area_t cannot index a 3x3 column area"
+#endif
+
+typedef struct { uint16_t pos; uint8_t chunk, light; } light_node_t;
+typedef struct { light_node_t *data; int head, tail, cap; bool heap; arena_t *arena; } light_queue_t;
+
+typedef struct {
+	Chunk *chunk;
+	uint8_t neighbor[6];  // area index across face d, LIGHT_UNRESOLVED until first crossed
+	bool written;
+} light_area_chunk_t;
+
+typedef struct {
+	light_area_chunk_t chunks[LIGHT_AREA_CHUNKS];
+	int count;
+} light_area_t;
+
+// Queues live in the job's arena while it has room, on the heap after that
+// or without an arena. Freeing or growing the newest arena queue reuses its
+// space; the caller releases the rest with arena_release.
+static light_node_t *lq_alloc(light_queue_t *q, int cap) {
+	light_node_t *data = arena_alloc(q->arena, cap * sizeof(light_node_t));
+	q->heap = !data;
+	return data ? data : malloc(cap * sizeof(light_node_t));
 }
 
-static bool set_light(int wx, int wy, int wz, uint8_t level) {
-	int ci_x, ci_y, ci_z, lx, ly, lz;
-	if (!world_to_chunk(wx, wy, wz, &ci_x, &ci_y, &ci_z, &lx, &ly, &lz)) return false;
-	Chunk *c = &chunks[ci_x][ci_y][ci_z];
-	if (!c->is_loaded) return false;
-	c->blocks[lx][ly][lz].light_level = level;
-	c->needs_update = true;
-	return true;
+static void lq_init(light_queue_t *q, arena_t *arena, int cap) {
+	q->arena = arena;
+	q->data  = lq_alloc(q, cap);
+	q->head  = q->tail = 0;
+	q->cap   = cap;
 }
-
-static uint8_t get_id(int wx, int wy, int wz) {
-	int ci_x, ci_y, ci_z, lx, ly, lz;
-	if (!world_to_chunk(wx, wy, wz, &ci_x, &ci_y, &ci_z, &lx, &ly, &lz)) return 1;
-	Chunk *c = &chunks[ci_x][ci_y][ci_z];
-	return c->is_loaded ? c->blocks[lx][ly][lz].id : 1;
+static void lq_free(light_queue_t *q) {
+	if (q->heap) free(q->data);
+	else arena_pop(q->arena, q->data, q->cap * sizeof(light_node_t));
+	q->data = NULL;
 }
-
-typedef struct { int32_t x, y, z; uint8_t sky, blk; } light_node_t;
-typedef struct { light_node_t *data; int head, tail, cap; } light_queue_t;
-
-static void lq_init(light_queue_t *q, int cap) {
-	q->data = malloc(cap * sizeof(light_node_t));
-	q->head = q->tail = 0;
-	q->cap  = cap;
-}
-static void      lq_free (light_queue_t *q)              { free(q->data); q->data = NULL; }
 static bool      lq_empty(const light_queue_t *q)        { return q->head >= q->tail; }
 static light_node_t lq_pop(light_queue_t *q)             { return q->data[q->head++]; }
 static void      lq_push (light_queue_t *q, light_node_t n) {
 	if (q->tail >= q->cap) {
+		size_t size = q->cap * sizeof(light_node_t);
 		q->cap *= 2;
-		q->data = realloc(q->data, q->cap * sizeof(light_node_t));
+		// The newest arena queue grows in place, anything else moves.
+		if (q->heap || !arena_extend(q->arena, q->data, size, 2 * size)) {
+			light_node_t *old = q->data;
+			bool old_heap = q->heap;
+			q->data = lq_alloc(q, q->cap);
+			memcpy(q->data, old, q->tail * sizeof(light_node_t));
+			if (old_heap) free(old);
+			else arena_pop(q->arena, old, size);
+		}
 	}
 	q->data[q->tail++] = n;
 }
@@ -103,273 +115,487 @@ static const int8_t ddx6[] = { 1,-1, 0, 0, 0, 0 };
 static const int8_t ddy6[] = { 0, 0, 1,-1, 0, 0 };
 static const int8_t ddz6[] = { 0, 0, 0, 0, 1,-1 };
 
-static void add_bfs(light_queue_t *aq) {
+// Per face: the packed step, the coordinate it moves and that coordinate's
+// value on the border it crosses.
+static const int16_t  pos_step[6] = { 1 << 8, -(1 << 8), 1 << 4, -(1 << 4), 1, -1 };
+static const uint16_t pos_mask[6] = { 0xF00, 0xF00, 0x0F0, 0x0F0, 0x00F, 0x00F };
+static const uint16_t pos_edge[6] = { 0xF00, 0x000, 0x0F0, 0x000, 0x00F, 0x000 };
+
+static void light_area_init(light_area_t *a) {
+	memset(&a->chunks[LIGHT_NO_CHUNK], 0, sizeof(light_area_chunk_t));
+	a->count = 1;
+}
+
+static uint8_t light_area_add(light_area_t *a, Chunk *c) {
+	if (!c || !c->is_loaded) return LIGHT_NO_CHUNK;
+	for (int i = 1; i < a->count; i++)
+		if (a->chunks[i].chunk == c) return i;
+	if (a->count == LIGHT_AREA_CHUNKS) return LIGHT_NO_CHUNK;
+	light_area_chunk_t *e = &a->chunks[a->count];
+	e->chunk = c;
+	memset(e->neighbor, LIGHT_UNRESOLVED, sizeof(e->neighbor));
+	e->written = false;
+	return a->count++;
+}
+
+// Flags every chunk the walk wrote to for remeshing.
+static void light_area_finish(light_area_t *a) {
+	for (int i = 1; i < a->count; i++)
+		if (a->chunks[i].written) a->chunks[i].chunk->needs_update = true;
+}
+
+// Moves one block across face d. Returns false, with *nci = LIGHT_NO_CHUNK,
+// when the block is not in a loaded chunk.
+static bool light_step(light_area_t *a, uint8_t ci, uint16_t pos, int d, uint8_t *nci, uint16_t *npos) {
+	if ((pos & pos_mask[d]) != pos_edge[d]) {
+		*nci  = ci;
+		*npos = pos + pos_step[d];
+		return ci != LIGHT_NO_CHUNK;
+	}
+	light_area_chunk_t *e = &a->chunks[ci];
+	if (e->neighbor[d] == LIGHT_UNRESOLVED) {
+		const Chunk *c = e->chunk;
+		e->neighbor[d] = light_area_add(a, get_chunk(c->x + ddx6[d], c->y + ddy6[d], c->z + ddz6[d]));
+	}
+	*nci  = e->neighbor[d];
+	*npos = pos ^ pos_mask[d];
+	return *nci != LIGHT_NO_CHUNK;
+}
+
+static uint8_t get_light(const light_area_t *a, uint8_t ci, uint16_t pos) {
+	if (ci == LIGHT_NO_CHUNK) return 0;
+	return chunk_get_light(a->chunks[ci].chunk, LIGHT_POS_X(pos), LIGHT_POS_Y(pos), LIGHT_POS_Z(pos));
+}
+
+static void set_light(light_area_t *a, uint8_t ci, uint16_t pos, uint8_t level) {
+	if (ci == LIGHT_NO_CHUNK) return;
+	chunk_set_light(a->chunks[ci].chunk, LIGHT_POS_X(pos), LIGHT_POS_Y(pos), LIGHT_POS_Z(pos), level);
+	a->chunks[ci].written = true;
+}
+
+static uint8_t get_id(const light_area_t *a, uint8_t ci, uint16_t pos) {
+	if (ci == LIGHT_NO_CHUNK) return 1;
+	return chunk_get_id(a->chunks[ci].chunk, LIGHT_POS_X(pos), LIGHT_POS_Y(pos), LIGHT_POS_Z(pos));
+}
+
+// Light a block of id receives from a neighbour lit light across face d.
+static uint8_t light_through(uint8_t light, uint8_t id, int d) {
+	uint8_t sky_op = get_sky_opacity(id);
+	uint8_t blk_op = get_block_opacity(id);
+	if (sky_op == 15) return 0;
+	uint8_t sky = SKY_LIGHT(light), blk = BLOCK_LIGHT(light);
+	uint8_t ns  = (d == LIGHT_DOWN && sky_op == 0) ? sky
+	            : (sky > 1 + sky_op   ? sky - 1 - sky_op : 0);
+	uint8_t nb  = blk > 1 + blk_op   ? blk - 1 - blk_op : 0;
+	return PACK_LIGHT(ns, nb);
+}
+
+// True when light arriving as in would raise a block lit cur.
+static bool light_raises(uint8_t in, uint8_t cur) {
+	return SKY_LIGHT(in) > SKY_LIGHT(cur) || BLOCK_LIGHT(in) > BLOCK_LIGHT(cur);
+}
+
+static void add_bfs(light_area_t *a, light_queue_t *aq) {
 	while (!lq_empty(aq)) {
 		light_node_t node = lq_pop(aq);
 		for (int d = 0; d < 6; d++) {
-			int nx = node.x + ddx6[d];
-			int ny = node.y + ddy6[d];
-			int nz = node.z + ddz6[d];
-			uint8_t nid    = get_id(nx, ny, nz);
-			uint8_t sky_op = get_sky_opacity(nid);
-			uint8_t blk_op = get_block_opacity(nid);
-			if (sky_op == 15) continue;
-			uint8_t cur = get_light(nx, ny, nz);
-			uint8_t cs  = SKY_LIGHT(cur), cb = BLOCK_LIGHT(cur);
-			uint8_t ns  = (d == 3 && sky_op == 0) ? node.sky
-			            : (node.sky > 1 + sky_op   ? node.sky - 1 - sky_op : 0);
-			uint8_t nb  = node.blk > 1 + blk_op   ? node.blk - 1 - blk_op : 0;
-			bool changed = false;
-			if (ns > cs) { cs = ns; changed = true; }
-			if (nb > cb) { cb = nb; changed = true; }
-			if (changed) {
-				set_light(nx, ny, nz, PACK_LIGHT(cs, cb));
-				lq_push(aq, (light_node_t){nx, ny, nz, cs, cb});
+			uint8_t  nc;
+			uint16_t np;
+			if (!light_step(a, node.chunk, node.pos, d, &nc, &np)) continue;
+			uint8_t in = light_through(node.light, get_id(a, nc, np), d);
+			if (!in) continue;
+			uint8_t cur = get_light(a, nc, np);
+			if (light_raises(in, cur)) {
+				uint8_t cs = SKY_LIGHT(in) > SKY_LIGHT(cur) ? SKY_LIGHT(in) : SKY_LIGHT(cur);
+				uint8_t cb = BLOCK_LIGHT(in) > BLOCK_LIGHT(cur) ? BLOCK_LIGHT(in) : BLOCK_LIGHT(cur);
+				set_light(a, nc, np, PACK_LIGHT(cs, cb));
+				lq_push(aq, (light_node_t){np, nc, PACK_LIGHT(cs, cb)});
 			}
 		}
 	}
 }
 
-static void remove_bfs(light_queue_t *rq, light_queue_t *aq) {
+static void remove_bfs(light_area_t *a, light_queue_t *rq, light_queue_t *aq) {
 	while (!lq_empty(rq)) {
 		light_node_t node = lq_pop(rq);
+		uint8_t sky = SKY_LIGHT(node.light), blk = BLOCK_LIGHT(node.light);
 		for (int d = 0; d < 6; d++) {
-			int nx = node.x + ddx6[d];
-			int ny = node.y + ddy6[d];
-			int nz = node.z + ddz6[d];
-			uint8_t cur    = get_light(nx, ny, nz);
+			uint8_t  nc;
+			uint16_t np;
+			if (!light_step(a, node.chunk, node.pos, d, &nc, &np)) continue;
+			uint8_t cur    = get_light(a, nc, np);
 			uint8_t cs     = SKY_LIGHT(cur), cb = BLOCK_LIGHT(cur);
 			if (cs == 0 && cb == 0) continue;
-			uint8_t nid    = get_id(nx, ny, nz);
+			uint8_t nid    = get_id(a, nc, np);
 			uint8_t sky_op = get_sky_opacity(nid);
 			uint8_t blk_op = get_block_opacity(nid);
 			if (sky_op == 15) continue;
 			bool rs = false, rb = false;
-			if (cs > 0 && node.sky > 0) {
-				uint8_t exp = (d == 3 && sky_op == 0) ? node.sky
-				            : (node.sky > 1 + sky_op   ? node.sky - 1 - sky_op : 0);
+			if (cs > 0 && sky > 0) {
+				uint8_t exp = (d == LIGHT_DOWN && sky_op == 0) ? sky
+				            : (sky > 1 + sky_op   ? sky - 1 - sky_op : 0);
 				if (cs <= exp) rs = true;
 			}
-			if (cb > 0 && node.blk > 0) {
-				uint8_t exp = node.blk > 1 + blk_op ? node.blk - 1 - blk_op : 0;
+			if (cb > 0 && blk > 0) {
+				uint8_t exp = blk > 1 + blk_op ? blk - 1 - blk_op : 0;
 				if (cb <= exp) rb = true;
 			}
-			if (!rs && !rb) { lq_push(aq, (light_node_t){nx,ny,nz,cs,cb}); continue; }
+			if (!rs && !rb) { lq_push(aq, (light_node_t){np, nc, cur}); continue; }
 			uint8_t ns = rs ? 0 : cs;
 			uint8_t nb = rb ? 0 : cb;
-			set_light(nx, ny, nz, PACK_LIGHT(ns, nb));
-			lq_push(rq, (light_node_t){nx, ny, nz, rs ? cs : 0, rb ? cb : 0});
-			uint8_t emit = get_block_emission(nid);
+			set_light(a, nc, np, PACK_LIGHT(ns, nb));
+			lq_push(rq, (light_node_t){np, nc, PACK_LIGHT(rs ? cs : 0, rb ? cb : 0)});
+			uint8_t emit = block_emission(nid);
 			uint8_t rs2  = rs ? 0 : cs;
 			uint8_t rb2  = rb ? 0 : cb;
 			if (emit > rb2) rb2 = emit;
-			if (rs2 > 0 || rb2 > 0) lq_push(aq, (light_node_t){nx, ny, nz, rs2, rb2});
+			if (rs2 > 0 || rb2 > 0) lq_push(aq, (light_node_t){np, nc, PACK_LIGHT(rs2, rb2)});
 		}
 	}
 }
 
-void init_column_lighting(Chunk col[WORLD_HEIGHT]) {
-	for (int cy = 0; cy < WORLD_HEIGHT; cy++)
-		for (int x = 0; x < CHUNK_SIZE; x++)
-			for (int y = 0; y < CHUNK_SIZE; y++)
-				for (int z = 0; z < CHUNK_SIZE; z++)
-					col[cy].blocks[x][y][z].light_level = 0;
+// Sky light reaching block y of column (x, z) from above. Only the partially
+// opaque span between dark and top is walked.
+static uint8_t sky_entering(Chunk col[WORLD_HEIGHT], int x, int y, int z) {
+	const column_sky_t *s = column_sky(col);
+	if (y >= s->top[x][z]) return MAX_LIGHT_LEVEL;
+	if (y <= s->dark[x][z]) return 0;
+	uint8_t sky = MAX_LIGHT_LEVEL;
+	for (int wy = s->top[x][z]; wy > y; wy--) {
+		uint8_t op = get_sky_opacity(chunk_get_id(&col[wy / CHUNK_SIZE], x, wy % CHUNK_SIZE, z));
+		if (op == 15 || (op > 0 && sky <= op)) return 0;
+		sky -= op;
+	}
+	return sky;
+}
+
+// Recomputes top and dark of (x, z) walking down from wy. Nothing above wy
+// may block the sky.
+static void scan_sky_column(Chunk col[WORLD_HEIGHT], int x, int z, int wy) {
+	column_sky_t *s = column_sky(col);
+	uint8_t sky = MAX_LIGHT_LEVEL;
+	s->top[x][z]  = -1;
+	s->dark[x][z] = -1;
+	for (; wy >= 0; wy--) {
+		uint8_t op = get_sky_opacity(chunk_get_id(&col[wy / CHUNK_SIZE], x, wy % CHUNK_SIZE, z));
+		if (op == 0) continue;
+		if (s->top[x][z] < 0) s->top[x][z] = wy;
+		if (op == 15 || sky <= op) { s->dark[x][z] = wy - 1; return; }
+		sky -= op;
+	}
+}
+
+// Builds the sky map of a column that already carries its light, e.g. one
+// read back from disk.
+void scan_column_sky(Chunk col[WORLD_HEIGHT]) {
+	int top = WORLD_HEIGHT - 1;
+	while (top >= 0 && chunk_is_uniform(&col[top], 0)) top--;
+	for (int x = 0; x < CHUNK_SIZE; x++)
+		for (int z = 0; z < CHUNK_SIZE; z++)
+			scan_sky_column(col, x, z, (top + 1) * CHUNK_SIZE - 1);
+}
+
+// Chunk summaries must be current. ctx, when the column was just generated,
+// bounds where the sky walk has to start reading block ids; everything above
+// its surface is known air. Also builds the column's sky map, so col must come
+// from chunk_column_acquire.
+void init_column_lighting(Chunk col[WORLD_HEIGHT], const column_context_t* ctx) {
+	column_sky_t *sky_map = column_sky(col);
+	// Uniform air at the top of the column sees the full sky without a
+	// per-block pass and keeps its light uniform.
+	int top = WORLD_HEIGHT - 1;
+	for (; top >= 0 && chunk_is_uniform(&col[top], 0); top--)
+		chunk_fill_light(&col[top], PACK_LIGHT(MAX_LIGHT_LEVEL, 0));
+	for (int cy = 0; cy <= top; cy++)
+		chunk_fill_light(&col[cy], 0);
 
 	for (int x = 0; x < CHUNK_SIZE; x++) {
 		for (int z = 0; z < CHUNK_SIZE; z++) {
 			uint8_t sky = MAX_LIGHT_LEVEL;
-			for (int cy = WORLD_HEIGHT - 1; cy >= 0 && sky > 0; cy--) {
-				for (int y = CHUNK_SIZE - 1; y >= 0 && sky > 0; y--) {
-					uint8_t op = get_sky_opacity(col[cy].blocks[x][y][z].id);
-					if (op == 15) { sky = 0; break; }
-					if (op > 0)   { if (sky <= op) { sky = 0; break; } sky -= op; }
-					col[cy].blocks[x][y][z].light_level = PACK_LIGHT(sky, 0);
+			int wy = (top + 1) * CHUNK_SIZE - 1;
+			sky_map->top[x][z]  = -1;
+			sky_map->dark[x][z] = -1;
+			if (ctx)
+				for (; wy > ctx->surface[x][z]; wy--)
+					chunk_set_light(&col[wy / CHUNK_SIZE], x, wy % CHUNK_SIZE, z, PACK_LIGHT(sky, 0));
+			for (; wy >= 0; wy--) {
+				Chunk *c = &col[wy / CHUNK_SIZE];
+				int y = wy % CHUNK_SIZE;
+				uint8_t op = get_sky_opacity(chunk_get_id(c, x, y, z));
+				if (op == 0) {
+					chunk_set_light(c, x, y, z, PACK_LIGHT(sky, 0));
+					continue;
 				}
+				if (sky_map->top[x][z] < 0) sky_map->top[x][z] = wy;
+				if (op == 15 || sky <= op) { sky_map->dark[x][z] = wy - 1; break; }
+				sky -= op;
+				chunk_set_light(c, x, y, z, PACK_LIGHT(sky, 0));
 			}
 		}
 	}
 
-	for (int cy = 0; cy < WORLD_HEIGHT; cy++)
+	for (int cy = 0; cy <= top; cy++) {
+		Chunk *c = &col[cy];
+		if (c->summary.has_emitters) {
+			for (int x = 0; x < CHUNK_SIZE; x++)
+				for (int y = 0; y < CHUNK_SIZE; y++)
+					for (int z = 0; z < CHUNK_SIZE; z++) {
+						uint8_t emit = block_emission(chunk_get_id(c, x, y, z));
+						if (!emit) continue;
+						uint8_t cur = chunk_get_light(c, x, y, z);
+						if (emit > BLOCK_LIGHT(cur))
+							chunk_set_light(c, x, y, z, PACK_LIGHT(SKY_LIGHT(cur), emit));
+					}
+		}
+		chunk_compact(c);
+	}
+
+	for (int cy = 0; cy < WORLD_HEIGHT; cy++) {
+		col[cy].lighting_changed = true;
+		col[cy].light_fresh = true;
+	}
+}
+
+void init_chunk_lighting(Chunk *chunk) { (void)chunk; }
+
+// In-plane steps across the border plane of each face pair.
+static const uint16_t plane_u[3] = { 1 << 4, 1 << 8, 1 << 8 };
+static const uint16_t plane_v[3] = { 1,      1,      1 << 4 };
+
+// The summary.opaque_faces bit (mesher face order) for each light direction.
+static const uint8_t summary_face[6] = { 1 << 1, 1 << 3, 1 << 5, 1 << 4, 1 << 0, 1 << 2 };
+
+// Relight for a chunk whose light still only holds init_column_lighting's
+// seeds. Light only grows as chunks arrive, so nothing has to be removed:
+// the BFS starts from the chunk's own lit blocks (none to spread within a
+// uniformly lit chunk) and from the border blocks on either side of each
+// face that would raise the block across it.
+static void spread_fresh_chunk(Chunk *chunk, arena_t *arena) {
+	light_area_t area;
+	light_area_init(&area);
+	uint8_t home = light_area_add(&area, chunk);
+	if (home == LIGHT_NO_CHUNK) return;
+
+	light_queue_t aq;
+	lq_init(&aq, arena, 16384);
+
+	if (chunk->light) {
 		for (int x = 0; x < CHUNK_SIZE; x++)
 			for (int y = 0; y < CHUNK_SIZE; y++)
 				for (int z = 0; z < CHUNK_SIZE; z++) {
-					uint8_t emit = get_block_emission(col[cy].blocks[x][y][z].id);
-					if (!emit) continue;
-					uint8_t cur = col[cy].blocks[x][y][z].light_level;
-					if (emit > BLOCK_LIGHT(cur))
-						col[cy].blocks[x][y][z].light_level = PACK_LIGHT(SKY_LIGHT(cur), emit);
+					uint8_t lv = chunk_get_light(chunk, x, y, z);
+					if (lv) lq_push(&aq, (light_node_t){LIGHT_POS(x, y, z), home, lv});
 				}
+	}
 
-	for (int cy = 0; cy < WORLD_HEIGHT; cy++)
-		col[cy].lighting_changed = true;
+	for (int d = 0; d < 6; d++) {
+		uint8_t  nc;
+		uint16_t np;
+		if (!light_step(&area, home, pos_edge[d], d, &nc, &np)) continue;
+		// Light crosses no border where both boundary layers are opaque.
+		if ((chunk->summary.opaque_faces & summary_face[d]) &&
+		    (area.chunks[nc].chunk->summary.opaque_faces & summary_face[d ^ 1]))
+			continue;
+		for (int u = 0; u < CHUNK_SIZE; u++)
+			for (int v = 0; v < CHUNK_SIZE; v++) {
+				uint16_t pos = pos_edge[d] + u * plane_u[d / 2] + v * plane_v[d / 2];
+				np = pos ^ pos_mask[d];
+				uint8_t lv = get_light(&area, home, pos);
+				uint8_t ln = get_light(&area, nc, np);
+				if (ln && light_raises(light_through(ln, get_id(&area, home, pos), d ^ 1), lv))
+					lq_push(&aq, (light_node_t){np, nc, ln});
+				if (lv && !chunk->light && light_raises(light_through(lv, get_id(&area, nc, np), d), ln))
+					lq_push(&aq, (light_node_t){pos, home, lv});
+			}
+	}
+
+	add_bfs(&area, &aq);
+	lq_free(&aq);
+	light_area_finish(&area);
+	chunk_compact(chunk);
 }
 
-void init_chunk_lighting(Chunk *chunk) { (void)chunk; }
+// Fresh chunks only spread their light (spread_fresh_chunk); anything else,
+// e.g. a column read back from disk, is recomputed from scratch.
+void relight_chunk(Chunk *chunk, arena_t *arena) {
+	if (chunk->light_fresh) {
+		chunk->light_fresh = false;
+		spread_fresh_chunk(chunk, arena);
+		return;
+	}
 
-void relight_chunk(Chunk *chunk) {
-	int wx0 = chunk->x * CHUNK_SIZE;
-	int wy0 = chunk->y * CHUNK_SIZE;
-	int wz0 = chunk->z * CHUNK_SIZE;
+	// Solid opaque chunks without light or emitters stay dark; the BFS below
+	// would not touch them.
+	const chunk_summary_t *s = &chunk->summary;
+	if (s->uniform && get_sky_opacity(s->uniform_id) == 15 && !s->has_emitters &&
+	    !chunk->light && chunk->light_fill == 0)
+		return;
+
+	light_area_t area;
+	light_area_init(&area);
+	uint8_t home = light_area_add(&area, chunk);
+	if (home == LIGHT_NO_CHUNK) return;
 
 	light_queue_t aq, rq;
-	lq_init(&aq, 16384);
-	lq_init(&rq, 8192);
+	lq_init(&aq, arena, 16384);
+	lq_init(&rq, arena, 8192);
 
 	for (int x = 0; x < CHUNK_SIZE; x++)
 		for (int y = 0; y < CHUNK_SIZE; y++)
 			for (int z = 0; z < CHUNK_SIZE; z++) {
-				uint8_t lv = chunk->blocks[x][y][z].light_level;
+				uint8_t lv = chunk_get_light(chunk, x, y, z);
 				if (!lv) continue;
-				chunk->blocks[x][y][z].light_level = 0;
-				lq_push(&rq, (light_node_t){wx0+x, wy0+y, wz0+z, SKY_LIGHT(lv), BLOCK_LIGHT(lv)});
+				lq_push(&rq, (light_node_t){LIGHT_POS(x, y, z), home, lv});
 			}
+	chunk_clear_light(chunk);
 
-	remove_bfs(&rq, &aq);
+	remove_bfs(&area, &rq, &aq);
 	lq_free(&rq);
 
+	Chunk *col = chunks[chunk->ci_x][0][chunk->ci_z];
+	int wy0 = chunk->y * CHUNK_SIZE;
 	for (int x = 0; x < CHUNK_SIZE; x++) {
 		for (int z = 0; z < CHUNK_SIZE; z++) {
-			uint8_t sky = MAX_LIGHT_LEVEL;
-			for (int cy = WORLD_HEIGHT - 1; cy > (int)chunk->ci_y; cy--) {
-				Chunk *above = &chunks[chunk->ci_x][cy][chunk->ci_z];
-				if (!above->is_loaded) break;
-				for (int by = CHUNK_SIZE - 1; by >= 0; by--) {
-					uint8_t op = get_sky_opacity(above->blocks[x][by][z].id);
-					if (op == 15) { sky = 0; goto rs_next; }
-					if (op > 0)   { if (sky <= op) { sky = 0; goto rs_next; } sky -= op; }
-				}
-			}
+			uint8_t sky = sky_entering(col, x, wy0 + CHUNK_SIZE - 1, z);
 			for (int y = CHUNK_SIZE - 1; y >= 0 && sky > 0; y--) {
-				uint8_t op = get_sky_opacity(chunk->blocks[x][y][z].id);
+				uint8_t op = get_sky_opacity(chunk_get_id(chunk, x, y, z));
 				if (op == 15) break;
 				if (op > 0) { if (sky <= op) { sky = 0; break; } sky -= op; }
-				uint8_t cur = chunk->blocks[x][y][z].light_level;
+				uint8_t cur = chunk_get_light(chunk, x, y, z);
 				if (sky > SKY_LIGHT(cur)) {
-					chunk->blocks[x][y][z].light_level = PACK_LIGHT(sky, BLOCK_LIGHT(cur));
-					lq_push(&aq, (light_node_t){wx0+x, wy0+y, wz0+z, sky, BLOCK_LIGHT(cur)});
+					chunk_set_light(chunk, x, y, z, PACK_LIGHT(sky, BLOCK_LIGHT(cur)));
+					lq_push(&aq, (light_node_t){LIGHT_POS(x, y, z), home, PACK_LIGHT(sky, BLOCK_LIGHT(cur))});
 				}
 			}
-			rs_next:;
 		}
 	}
 
-	for (int x = 0; x < CHUNK_SIZE; x++)
+	for (int x = 0; x < CHUNK_SIZE && s->has_emitters; x++)
 		for (int y = 0; y < CHUNK_SIZE; y++)
 			for (int z = 0; z < CHUNK_SIZE; z++) {
-				uint8_t emit = get_block_emission(chunk->blocks[x][y][z].id);
+				uint8_t emit = block_emission(chunk_get_id(chunk, x, y, z));
 				if (!emit) continue;
-				uint8_t cur = chunk->blocks[x][y][z].light_level;
+				uint8_t cur = chunk_get_light(chunk, x, y, z);
 				if (emit > BLOCK_LIGHT(cur)) {
-					chunk->blocks[x][y][z].light_level = PACK_LIGHT(SKY_LIGHT(cur), emit);
-					lq_push(&aq, (light_node_t){wx0+x, wy0+y, wz0+z, SKY_LIGHT(cur), emit});
+					chunk_set_light(chunk, x, y, z, PACK_LIGHT(SKY_LIGHT(cur), emit));
+					lq_push(&aq, (light_node_t){LIGHT_POS(x, y, z), home, PACK_LIGHT(SKY_LIGHT(cur), emit)});
 				}
 			}
 
-	add_bfs(&aq);
+	add_bfs(&area, &aq);
 	lq_free(&aq);
+	light_area_finish(&area);
+	chunk_compact(chunk);
 }
 
-static void seed_sky_col_down(int wx, int wy, int wz, uint8_t sky, light_queue_t *aq) {
-	for (int y = wy; y >= 0; y--) {
-		uint8_t op = get_sky_opacity(get_id(wx, y, wz));
+static void seed_sky_col_down(light_area_t *a, uint8_t ci, uint16_t pos, uint8_t sky, light_queue_t *aq) {
+	for (; ci != LIGHT_NO_CHUNK; light_step(a, ci, pos, LIGHT_DOWN, &ci, &pos)) {
+		uint8_t op = get_sky_opacity(get_id(a, ci, pos));
 		if (op == 15) break;
 		if (op > 0) { if (sky <= op) { sky = 0; break; } sky -= op; }
-		uint8_t cur = get_light(wx, y, wz);
+		uint8_t cur = get_light(a, ci, pos);
 		if (sky > SKY_LIGHT(cur)) {
-			set_light(wx, y, wz, PACK_LIGHT(sky, BLOCK_LIGHT(cur)));
-			lq_push(aq, (light_node_t){wx, y, wz, sky, BLOCK_LIGHT(cur)});
+			set_light(a, ci, pos, PACK_LIGHT(sky, BLOCK_LIGHT(cur)));
+			lq_push(aq, (light_node_t){pos, ci, PACK_LIGHT(sky, BLOCK_LIGHT(cur))});
 		}
 	}
 }
 
-static void rem_sky_col_down(int wx, int wy, int wz, light_queue_t *rq) {
-	for (int y = wy; y >= 0; y--) {
-		if (get_sky_opacity(get_id(wx, y, wz)) == 15) break;
-		uint8_t cl = get_light(wx, y, wz);
+static void rem_sky_col_down(light_area_t *a, uint8_t ci, uint16_t pos, light_queue_t *rq) {
+	for (; ci != LIGHT_NO_CHUNK; light_step(a, ci, pos, LIGHT_DOWN, &ci, &pos)) {
+		if (get_sky_opacity(get_id(a, ci, pos)) == 15) break;
+		uint8_t cl = get_light(a, ci, pos);
 		uint8_t cs = SKY_LIGHT(cl), cb = BLOCK_LIGHT(cl);
 		if (cs == 0) break;
-		set_light(wx, y, wz, PACK_LIGHT(0, cb));
-		lq_push(rq, (light_node_t){wx, y, wz, cs, 0});
+		set_light(a, ci, pos, PACK_LIGHT(0, cb));
+		lq_push(rq, (light_node_t){pos, ci, PACK_LIGHT(cs, 0)});
 	}
 }
 
-static uint8_t sky_above(int wx, int wy, int wz) {
-	uint8_t sky = MAX_LIGHT_LEVEL;
-	for (int y = wy + 1; y < WORLD_HEIGHT * CHUNK_SIZE; y++) {
-		uint8_t op = get_sky_opacity(get_id(wx, y, wz));
-		if (op == 15) return 0;
-		if (op > 0) { if (sky <= op) return 0; sky -= op; }
-	}
-	return sky;
-}
-
 void update_block_lighting(int wx, int wy, int wz, uint8_t old_id, uint8_t new_id) {
+	int lx, ly, lz;
+	light_area_t area;
+	light_area_init(&area);
+	uint8_t  home = light_area_add(&area, world_to_chunk(wx, wy, wz, &lx, &ly, &lz));
+	uint16_t pos  = LIGHT_POS(lx, ly, lz);
+	if (home == LIGHT_NO_CHUNK) return;
+
 	light_queue_t aq, rq;
-	lq_init(&aq, 4096);
-	lq_init(&rq, 4096);
+	// Edits come from the main thread, which has no job arena.
+	lq_init(&aq, NULL, 4096);
+	lq_init(&rq, NULL, 4096);
 
-	uint8_t old_emit   = get_block_emission(old_id);
-	uint8_t new_emit   = get_block_emission(new_id);
+	uint8_t old_emit   = block_emission(old_id);
+	uint8_t new_emit   = block_emission(new_id);
 	uint8_t old_sky_op = get_sky_opacity(old_id);
 	uint8_t new_sky_op = get_sky_opacity(new_id);
 
+	const Chunk *home_chunk = area.chunks[home].chunk;
+	Chunk *col = chunks[home_chunk->ci_x][0][home_chunk->ci_z];
+	if (old_sky_op != new_sky_op) {
+		int top = column_sky(col)->top[lx][lz];
+		scan_sky_column(col, lx, lz, wy > top ? wy : top);
+	}
+
 	if (old_emit > 0) {
-		uint8_t cur = get_light(wx, wy, wz);
+		uint8_t cur = get_light(&area, home, pos);
 		uint8_t cb  = BLOCK_LIGHT(cur);
 		if (cb > 0) {
-			set_light(wx, wy, wz, PACK_LIGHT(SKY_LIGHT(cur), 0));
-			lq_push(&rq, (light_node_t){wx, wy, wz, 0, cb});
-			remove_bfs(&rq, &aq);
+			set_light(&area, home, pos, PACK_LIGHT(SKY_LIGHT(cur), 0));
+			lq_push(&rq, (light_node_t){pos, home, PACK_LIGHT(0, cb)});
+			remove_bfs(&area, &rq, &aq);
 			rq.head = rq.tail = 0;
 		}
 	}
 
 	if (old_sky_op != new_sky_op) {
 		if (new_sky_op > old_sky_op) {
-			uint8_t cur = get_light(wx, wy, wz);
+			uint8_t cur = get_light(&area, home, pos);
 			uint8_t cs  = SKY_LIGHT(cur);
 			if (cs > 0) {
-				set_light(wx, wy, wz, PACK_LIGHT(0, BLOCK_LIGHT(cur)));
-				lq_push(&rq, (light_node_t){wx, wy, wz, cs, 0});
+				set_light(&area, home, pos, PACK_LIGHT(0, BLOCK_LIGHT(cur)));
+				lq_push(&rq, (light_node_t){pos, home, PACK_LIGHT(cs, 0)});
 			}
-			rem_sky_col_down(wx, wy - 1, wz, &rq);
-			remove_bfs(&rq, &aq);
+			uint8_t  below;
+			uint16_t below_pos;
+			light_step(&area, home, pos, LIGHT_DOWN, &below, &below_pos);
+			rem_sky_col_down(&area, below, below_pos, &rq);
+			remove_bfs(&area, &rq, &aq);
 			rq.head = rq.tail = 0;
 		} else {
-			uint8_t si = sky_above(wx, wy, wz);
-			if (si > 0) seed_sky_col_down(wx, wy, wz, si, &aq);
+			uint8_t si = sky_entering(col, lx, wy, lz);
+			if (si > 0) seed_sky_col_down(&area, home, pos, si, &aq);
 			for (int d = 0; d < 6; d++) {
-				int nx = wx + ddx6[d], ny = wy + ddy6[d], nz = wz + ddz6[d];
-				uint8_t nb = get_light(nx, ny, nz);
-				if (SKY_LIGHT(nb) || BLOCK_LIGHT(nb))
-					lq_push(&aq, (light_node_t){nx, ny, nz, SKY_LIGHT(nb), BLOCK_LIGHT(nb)});
+				uint8_t  nc;
+				uint16_t np;
+				light_step(&area, home, pos, d, &nc, &np);
+				uint8_t nb = get_light(&area, nc, np);
+				if (nb) lq_push(&aq, (light_node_t){np, nc, nb});
 			}
 		}
 	} else if (new_sky_op == 15) {
-		uint8_t cur = get_light(wx, wy, wz);
+		uint8_t cur = get_light(&area, home, pos);
 		if (cur > 0) {
-			set_light(wx, wy, wz, 0);
-			lq_push(&rq, (light_node_t){wx, wy, wz, SKY_LIGHT(cur), BLOCK_LIGHT(cur)});
-			remove_bfs(&rq, &aq);
+			set_light(&area, home, pos, 0);
+			lq_push(&rq, (light_node_t){pos, home, cur});
+			remove_bfs(&area, &rq, &aq);
 			rq.head = rq.tail = 0;
 		}
 	}
 
 	if (new_emit > 0) {
-		uint8_t cs = SKY_LIGHT(get_light(wx, wy, wz));
-		set_light(wx, wy, wz, PACK_LIGHT(cs, new_emit));
-		lq_push(&aq, (light_node_t){wx, wy, wz, cs, new_emit});
+		uint8_t cs = SKY_LIGHT(get_light(&area, home, pos));
+		set_light(&area, home, pos, PACK_LIGHT(cs, new_emit));
+		lq_push(&aq, (light_node_t){pos, home, PACK_LIGHT(cs, new_emit)});
 	}
 
-	add_bfs(&aq);
+	add_bfs(&area, &aq);
 	lq_free(&aq);
 	lq_free(&rq);
 
-	int ci_x, ci_y, ci_z, lx, ly, lz;
-	if (world_to_chunk(wx, wy, wz, &ci_x, &ci_y, &ci_z, &lx, &ly, &lz)) {
-		Chunk *c = &chunks[ci_x][ci_y][ci_z];
-		if (c->is_loaded) c->lighting_changed = true;
-	}
+	light_area_finish(&area);
+	area.chunks[home].chunk->lighting_changed = true;
+	area.chunks[home].chunk->light_fresh = false;
 }
 
 unsigned char* generate_light_texture() { return NULL; }
@@ -4,270 +4,191 @@
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
-#include <errno.h>
 #include <stdio.h>
+#include <stdint.h>
 
-void relight_chunk(Chunk *chunk);
+void relight_chunk(Chunk *chunk, arena_t *arena);
 
-static pthread_t mesh_thread;
-static pthread_mutex_t mesh_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t mesh_queue_cond = PTHREAD_COND_INITIALIZER;
-static pthread_mutex_t mesh_ready_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t mesh_ready_cond = PTHREAD_COND_INITIALIZER;
-static _Atomic bool mesh_thread_running = false;
-static _Atomic bool mesh_thread_should_exit = false;
+// One scratch buffer per worker; mesh jobs run on the shared job pool.
+static mesh_scratch_t* mesh_scratch = NULL;
+static int mesh_scratch_count = 0;
 
 typedef struct {
 	uint8_t x, y, z;
-	uint32_t timestamp;
 } chunk_mesh_job_t;
 
-#define MAX_MESH_QUEUE_SIZE 4096
-static chunk_mesh_job_t mesh_queue[MAX_MESH_QUEUE_SIZE];
-static int mesh_queue_head = 0;
-static int mesh_queue_tail = 0;
-static int mesh_queue_count = 0;
-static uint32_t job_counter = 0;
-
-static bool enqueue_mesh_job(uint8_t x, uint8_t y, uint8_t z) {
-	int result = pthread_mutex_lock(&mesh_queue_mutex);
-	if (result != 0) {
-		fprintf(stderr, "Failed to lock mesh queue mutex: %s\n", strerror(result));
-		return false;
-	}
-
-	for (int i = 0; i < mesh_queue_count; i++) {
-		int idx = (mesh_queue_head + i) % MAX_MESH_QUEUE_SIZE;
-		if (mesh_queue[idx].x == x && mesh_queue[idx].y == y && mesh_queue[idx].z == z) {
-			mesh_queue[idx].timestamp = ++job_counter;
-			pthread_mutex_unlock(&mesh_queue_mutex);
+// A neighbour that is due a relight marks this chunk for meshing again when
+// it runs, so meshing now would only be thrown away. Whether the neighbour
+// can relight yet depends on columns outside the locked area; mesh jobs
+// only run once those are generated (mesh_column_deps), so it is assumed.
+static bool neighbor_relight_pending(const Chunk* chunk) {
+	static const int8_t ndx[] = { 1,-1, 0, 0, 0, 0 };
+	static const int8_t ndy[] = { 0, 0, 1,-1, 0, 0 };
+	static const int8_t ndz[] = { 0, 0, 0, 0, 1,-1 };
+	for (int d = 0; d < 6; d++) {
+		Chunk* nc = get_chunk(chunk->x + ndx[d], chunk->y + ndy[d], chunk->z + ndz[d]);
+		if (nc && nc->is_loaded && nc->needs_update && nc->lighting_changed)
 			return true;
-		}
 	}
-
-	if (mesh_queue_count < MAX_MESH_QUEUE_SIZE) {
-		mesh_queue[mesh_queue_tail].x = x;
-		mesh_queue[mesh_queue_tail].y = y;
-		mesh_queue[mesh_queue_tail].z = z;
-		mesh_queue[mesh_queue_tail].timestamp = ++job_counter;
-		mesh_queue_tail = (mesh_queue_tail + 1) % MAX_MESH_QUEUE_SIZE;
-		mesh_queue_count++;
-		
-		pthread_cond_signal(&mesh_queue_cond);
-		pthread_mutex_unlock(&mesh_queue_mutex);
-		return true;
-	}
-	
-	pthread_mutex_unlock(&mesh_queue_mutex);
 	return false;
 }
 
-static bool dequeue_mesh_job(chunk_mesh_job_t* job) {
-	int result = pthread_mutex_lock(&mesh_queue_mutex);
-	if (result != 0) {
-		fprintf(stderr, "Failed to lock mesh queue mutex: %s\n", strerror(result));
-		return false;
-	}
-	
-	if (mesh_queue_count == 0) {
-		pthread_mutex_unlock(&mesh_queue_mutex);
-		return false;
-	}
-	
-	*job = mesh_queue[mesh_queue_head];
-	mesh_queue_head = (mesh_queue_head + 1) % MAX_MESH_QUEUE_SIZE;
-	mesh_queue_count--;
-	
-	pthread_mutex_unlock(&mesh_queue_mutex);
-	return true;
-}
-
-static void* mesh_thread_worker(void* arg) {
-	chunk_mesh_job_t job;
-
-	while (!atomic_load(&mesh_thread_should_exit)) {
-		struct timespec timeout;
-		clock_gettime(CLOCK_REALTIME, &timeout);
-		timeout.tv_sec += 1;
-
-		int result = pthread_mutex_lock(&mesh_queue_mutex);
-		if (result != 0) {
-			fprintf(stderr, "Mesh thread mutex lock failed: %s\n", strerror(result));
-			break;
-		}
-
-		while (mesh_queue_count == 0 && !atomic_load(&mesh_thread_should_exit)) {
-			result = pthread_cond_timedwait(&mesh_queue_cond, &mesh_queue_mutex, &timeout);
-			if (result == ETIMEDOUT) {
-				pthread_mutex_unlock(&mesh_queue_mutex);
-				continue;
-			} else if (result != 0) {
-				fprintf(stderr, "Mesh thread cond wait failed: %s\n", strerror(result));
-				pthread_mutex_unlock(&mesh_queue_mutex);
-				goto exit_thread;
-			}
-		}
-		pthread_mutex_unlock(&mesh_queue_mutex);
-
-		if (atomic_load(&mesh_thread_should_exit)) break;
+// Holds the window read lock and the columns around the job's slot while
+// relighting and snapshotting, but not while meshing. The finished mesh is
+// swapped in under the locks, so the renderer never uploads one in the making.
+static void process_mesh_job(const chunk_mesh_job_t* job, mesh_scratch_t* scratch, arena_t* arena) {
+	if (job->x >= settings.render_distance || job->y >= WORLD_HEIGHT || job->z >= settings.render_distance)
+		return;
 
-		while (dequeue_mesh_job(&job)) {
-			result = pthread_mutex_lock(&chunks_mutex);
-			if (result != 0) {
-				fprintf(stderr, "Failed to lock chunks mutex: %s\n", strerror(result));
-				continue;
-			}
+	column_area_t area;
+	pthread_rwlock_rdlock(&chunk_window_lock);
+	column_lock_area(&area, job->x, job->z);
 
-			if (job.x >= settings.render_distance || job.y >= WORLD_HEIGHT || job.z >= settings.render_distance) {
-				pthread_mutex_unlock(&chunks_mutex);
-				continue;
-			}
+	Chunk* chunk = chunks[job->x][job->y][job->z];
+	chunk->mesh_queued = false;
 
-			Chunk* chunk = &chunks[job.x][job.y][job.z];
+	// A chunk is only ever meshed by one worker. If another worker owns it,
+	// that worker re-checks needs_update before letting go.
+	if (chunk->mesh_busy || !chunk->needs_update) {
+		column_unlock_area(&area);
+		pthread_rwlock_unlock(&chunk_window_lock);
+		return;
+	}
+	chunk->mesh_busy = true;
 
-			if (chunk->needs_update) {
-				if (chunk->lighting_changed && are_all_neighbors_loaded(job.x, job.y, job.z)) {
-					chunk->lighting_changed = false;
-					// Release mutex before BFS — it touches block data only, not chunk
-					// structure. get/set helpers check is_loaded so unloads are safe.
-					pthread_mutex_unlock(&chunks_mutex);
-#ifdef DEBUG
-					profiler_start(PROFILER_ID_RELIGHT, false);
-#endif
-					relight_chunk(chunk);
+	while (chunk->needs_update && chunk->is_loaded) {
+		if (chunk->lighting_changed && are_all_neighbors_loaded(chunk)) {
+			chunk->lighting_changed = false;
+			// The BFS stays within the locked columns: light fades out
+			// before it crosses a whole neighbouring column.
 #ifdef DEBUG
-					profiler_stop(PROFILER_ID_RELIGHT, false);
+			profiler_start(PROFILER_ID_RELIGHT, false);
 #endif
-					pthread_mutex_lock(&chunks_mutex);
-					// Re-validate chunk is still loaded after reacquiring.
-					if (!chunk->is_loaded) {
-						pthread_mutex_unlock(&chunks_mutex);
-						continue;
-					}
-					static const int8_t ndx[] = { 1,-1, 0, 0, 0, 0 };
-					static const int8_t ndy[] = { 0, 0, 1,-1, 0, 0 };
-					static const int8_t ndz[] = { 0, 0, 0, 0, 1,-1 };
-					for (int d = 0; d < 6; d++) {
-						int nx2 = (int)job.x + ndx[d];
-						int ny2 = (int)job.y + ndy[d];
-						int nz2 = (int)job.z + ndz[d];
-						if (nx2 < 0 || nx2 >= settings.render_distance) continue;
-						if (ny2 < 0 || ny2 >= WORLD_HEIGHT) continue;
-						if (nz2 < 0 || nz2 >= settings.render_distance) continue;
-						Chunk* nc = &chunks[nx2][ny2][nz2];
-						if (nc->is_loaded && !nc->needs_update)
-							nc->needs_update = true;
-					}
-				}
-				// Release mutex during mesh build — only reads blocks[], writes faces[].
-				chunk->needs_update = false;
-				pthread_mutex_unlock(&chunks_mutex);
+			// Each relight starts from the same arena space.
+			size_t mark = arena_mark(arena);
+			relight_chunk(chunk, arena);
+			arena_release(arena, mark);
 #ifdef DEBUG
-				profiler_start(PROFILER_ID_MESH, false);
-#endif
-				generate_chunk_mesh(chunk);
-#ifdef DEBUG
-				profiler_stop(PROFILER_ID_MESH, false);
+			profiler_stop(PROFILER_ID_RELIGHT, false);
 #endif
+			static const int8_t ndx[] = { 1,-1, 0, 0, 0, 0 };
+			static const int8_t ndy[] = { 0, 0, 1,-1, 0, 0 };
+			static const int8_t ndz[] = { 0, 0, 0, 0, 1,-1 };
+			for (int d = 0; d < 6; d++) {
+				Chunk* nc = get_chunk(chunk->x + ndx[d], chunk->y + ndy[d], chunk->z + ndz[d]);
+				if (nc && nc->is_loaded && !nc->needs_update)
+					nc->needs_update = true;
+			}
+		}
+		// Left in needs_update; process_chunks queues it again.
+		if (neighbor_relight_pending(chunk))
+			break;
+		// Mesh from a snapshot so world-gen threads can replace neighbour
+		// slots while the columns are unlocked.
+		chunk->needs_update = false;
+		if (chunk_mesh_is_empty(chunk)) {
+			// Nothing to snapshot or mesh; only drop a mesh left from before.
+			if (chunk->mesh.block) {
+				chunk_mesh_free(&chunk->mesh);
 				chunk->mesh_dirty = true;
 				atomic_store(&mesh_needs_rebuild, true);
-				continue; // mutex already unlocked
 			}
-
-			pthread_mutex_unlock(&chunks_mutex);
+			continue;
 		}
+		snapshot_chunk(chunk, &scratch->snapshot);
+		column_unlock_area(&area);
+		pthread_rwlock_unlock(&chunk_window_lock);
+#ifdef DEBUG
+		profiler_start(PROFILER_ID_MESH, false);
+#endif
+		chunk_mesh_t mesh;
+		generate_chunk_mesh(scratch, &mesh);
+#ifdef DEBUG
+		profiler_stop(PROFILER_ID_MESH, false);
+#endif
+		// The slot may hold a newer column by now; this chunk's flags are
+		// still written under the slot's lock.
+		pthread_rwlock_rdlock(&chunk_window_lock);
+		column_lock_area(&area, job->x, job->z);
+		chunk_mesh_free(&chunk->mesh);
+		chunk->mesh = mesh;
+		chunk->mesh_dirty = true;
+		atomic_store(&mesh_needs_rebuild, true);
 	}
 
-exit_thread:
-	atomic_store(&mesh_thread_running, false);
-	return NULL;
+	chunk->mesh_busy = false;
+	column_unlock_area(&area);
+	pthread_rwlock_unlock(&chunk_window_lock);
 }
 
-
-bool init_mesh_thread() {
-	if (atomic_load(&mesh_thread_running)) return true;
-	
-	atomic_store(&mesh_thread_should_exit, false);
-	
-	int result = pthread_create(&mesh_thread, NULL, mesh_thread_worker, NULL);
-	if (result != 0) {
-		fprintf(stderr, "Failed to create mesh thread: %s\n", strerror(result));
-		return false;
-	}
-	
-	atomic_store(&mesh_thread_running, true);
-	return true;
+static void mesh_job(void* arg, int worker) {
+	uintptr_t slot = (uintptr_t)arg;
+	chunk_mesh_job_t job = { (slot >> 16) & 0xFF, (slot >> 8) & 0xFF, slot & 0xFF };
+	if (worker < mesh_scratch_count)
+		process_mesh_job(&job, &mesh_scratch[worker], job_arena(worker));
 }
 
-void cleanup_mesh_thread() {
-	if (!atomic_load(&mesh_thread_running)) return;
+// Call after jobs_init.
+bool init_mesh_workers() {
+	if (mesh_scratch) return true;
 
-	atomic_store(&mesh_thread_should_exit, true);
+	int count = jobs_thread_count();
+	mesh_scratch = calloc(count, sizeof(mesh_scratch_t));
+	if (!mesh_scratch) return false;
+	for (mesh_scratch_count = 0; mesh_scratch_count < count; mesh_scratch_count++) {
+		if (!mesh_scratch_init(&mesh_scratch[mesh_scratch_count])) {
+			fprintf(stderr, "Failed to allocate mesh scratch buffers\n");
+			break;
+		}
+	}
+	return mesh_scratch_count > 0;
+}
 
-	pthread_mutex_lock(&mesh_queue_mutex);
-	pthread_cond_broadcast(&mesh_queue_cond);
-	pthread_mutex_unlock(&mesh_queue_mutex);
-	
-	pthread_mutex_lock(&mesh_ready_mutex);
-	pthread_cond_broadcast(&mesh_ready_cond);
-	pthread_mutex_unlock(&mesh_ready_mutex);
+// Call after jobs_shutdown.
+void cleanup_mesh_workers() {
+	for (int i = 0; i < mesh_scratch_count; i++)
+		mesh_scratch_free(&mesh_scratch[i]);
+	free(mesh_scratch);
+	mesh_scratch = NULL;
+	mesh_scratch_count = 0;
+}
 
-	int result = pthread_join(mesh_thread, NULL);
-	if (result != 0) {
-		fprintf(stderr, "Failed to join mesh thread: %s\n", strerror(result));
-	}
-	
-	atomic_store(&mesh_thread_running, false);
+// Queues a mesh (and relight, if due) of ring slot (x, y, z) that waits for
+// every counter in deps to drain. mesh_queued is set before submitting, so a
+// job that starts at once cannot have its clear overwritten. If the job is
+// not accepted the chunk keeps needs_update, so process_chunks queues it
+// again.
+bool queue_chunk_mesh(uint8_t x, uint8_t y, uint8_t z, job_priority_t priority,
+                      job_counter_t* const* deps, int dep_count) {
+	Chunk* chunk = chunks[x][y][z];
+	uintptr_t slot = (uintptr_t)x << 16 | (uintptr_t)y << 8 | z;
+	chunk->mesh_queued = true;
+	bool queued = job_submit_after(mesh_job, (void*)slot, priority, deps, dep_count);
+	if (!queued) chunk->mesh_queued = false;
+	return queued;
 }
 
+// Player edits jump ahead of regular meshing and generation.
 void enqueue_chunk_update_priority(uint8_t x, uint8_t y, uint8_t z) {
-	pthread_mutex_lock(&mesh_queue_mutex);
-	// Remove any existing entry for this chunk.
-	for (int i = 0; i < mesh_queue_count; i++) {
-		int idx = (mesh_queue_head + i) % MAX_MESH_QUEUE_SIZE;
-		if (mesh_queue[idx].x == x && mesh_queue[idx].y == y && mesh_queue[idx].z == z) {
-			for (int j = i; j < mesh_queue_count - 1; j++) {
-				int cur  = (mesh_queue_head + j)     % MAX_MESH_QUEUE_SIZE;
-				int next = (mesh_queue_head + j + 1) % MAX_MESH_QUEUE_SIZE;
-				mesh_queue[cur] = mesh_queue[next];
-			}
-			mesh_queue_count--;
-			mesh_queue_tail = (mesh_queue_tail - 1 + MAX_MESH_QUEUE_SIZE) % MAX_MESH_QUEUE_SIZE;
-			break;
-		}
-	}
-	if (mesh_queue_count < MAX_MESH_QUEUE_SIZE) {
-		mesh_queue_head = (mesh_queue_head - 1 + MAX_MESH_QUEUE_SIZE) % MAX_MESH_QUEUE_SIZE;
-		mesh_queue[mesh_queue_head].x = x;
-		mesh_queue[mesh_queue_head].y = y;
-		mesh_queue[mesh_queue_head].z = z;
-		mesh_queue[mesh_queue_head].timestamp = ++job_counter;
-		mesh_queue_count++;
-		pthread_cond_signal(&mesh_queue_cond);
-	}
-	pthread_mutex_unlock(&mesh_queue_mutex);
+	queue_chunk_mesh(x, y, z, JOB_PRIORITY_HIGH, NULL, 0);
 }
 
+// Main thread only: it queues from every column without the window lock.
+// The flags it reads are atomic, so the scan takes no column locks either.
+// A chunk queued twice is harmless: the second job finds it up to date.
 void process_chunks() {
-	int result = pthread_mutex_lock(&chunks_mutex);
-	if (result != 0) {
-		fprintf(stderr, "Failed to lock chunks mutex in process_chunks: %s\n", strerror(result));
-		return;
-	}
-
 	for (uint8_t x = 0; x < settings.render_distance; x++) {
-		for (uint8_t y = 0; y < WORLD_HEIGHT; y++) {
-			for (uint8_t z = 0; z < settings.render_distance; z++) {
-				Chunk* chunk = &chunks[x][y][z];
-				if (chunk->needs_update && chunk->is_loaded) {
-					if (!enqueue_mesh_job(x, y, z)) {
-						#ifdef DEBUG
-						printf("Warning: Mesh queue full, dropping job for chunk (%d,%d,%d)\n", x, y, z);
-						#endif
-					}
+		for (uint8_t z = 0; z < settings.render_distance; z++) {
+			for (uint8_t y = 0; y < WORLD_HEIGHT; y++) {
+				Chunk* chunk = chunks[x][y][z];
+				// Queued chunks are picked up by their job; a busy worker
+				// re-checks needs_update before letting go.
+				if (chunk->needs_update && chunk->is_loaded && !chunk->mesh_queued && !chunk->mesh_busy) {
+					job_counter_t* deps[MESH_COLUMN_DEPS];
+					int dep_count = mesh_column_deps(chunk->x, chunk->z, deps);
+					queue_chunk_mesh(x, y, z, JOB_PRIORITY_NORMAL, deps, dep_count);
 				}
 			}
 		}
 	}
-	pthread_mutex_unlock(&chunks_mutex);
-}
\ No newline at end of file
+}
@@ -1,69 +1,77 @@
 #include "main.h"
 #include "config.h"
+#include <string.h>
 
-bool are_all_neighbors_loaded(uint8_t x, uint8_t y, uint8_t z) {
-	if (x > 0                           && !chunks[x-1][y][z].is_loaded) return false;
-	if (x < settings.render_distance-1  && !chunks[x+1][y][z].is_loaded) return false;
-	if (y > 0                           && !chunks[x][y-1][z].is_loaded) return false;
-	if (y < WORLD_HEIGHT-1              && !chunks[x][y+1][z].is_loaded) return false;
-	if (z > 0                           && !chunks[x][y][z-1].is_loaded) return false;
-	if (z < settings.render_distance-1  && !chunks[x][y][z+1].is_loaded) return false;
-	return true;
-}
+static const int8_t face_dx[6] = { 0,  1,  0, -1,  0,  0 };
+static const int8_t face_dy[6] = { 0,  0,  0,  0, -1,  1 };
+static const int8_t face_dz[6] = { 1,  0, -1,  0,  0,  0 };
 
-static inline bool check_bounds(int8_t val, int8_t *ci, int8_t *coord) {
-	if (val < 0)          { *ci -= 1; *coord = CHUNK_SIZE - 1; return true; }
-	if (val >= CHUNK_SIZE){ *ci += 1; *coord = 0;              return true; }
-	return false;
+bool are_all_neighbors_loaded(const Chunk *chunk) {
+	for (int f = 0; f < 6; f++) {
+		Chunk *nc = get_chunk(chunk->x + face_dx[f], chunk->y + face_dy[f], chunk->z + face_dz[f]);
+		if (nc && !nc->is_loaded) return false;
+	}
+	return true;
 }
 
-bool is_face_visible(Chunk *chunk, int8_t x, int8_t y, int8_t z, uint8_t face) {
-	int8_t nx = x, ny = y, nz = z;
-	int8_t cix = chunk->ci_x, ciy = chunk->ci_y, ciz = chunk->ci_z;
-
-	switch (face) {
-		case 0: nz++; break;
-		case 1: nx++; break;
-		case 2: nz--; break;
-		case 3: nx--; break;
-		case 4: ny--; break;
-		case 5: ny++; break;
-		default: return false;
+// True when meshing the chunk would produce no quads: it has no blocks, or it
+// is all full opaque cubes with an opaque boundary facing it on every side.
+// Neighbours outside the render area read as air, so they never enclose.
+// Caller holds the column locks around the chunk (column_lock_area).
+bool chunk_mesh_is_empty(const Chunk *chunk) {
+	const chunk_summary_t *s = &chunk->summary;
+	if (s->block_count == 0) return true;
+	if (s->cube_count != CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE) return false;
+	for (int f = 0; f < 6; f++) {
+		Chunk *nc = get_chunk(chunk->x + face_dx[f], chunk->y + face_dy[f], chunk->z + face_dz[f]);
+		// Face f of this chunk touches the neighbour's opposite face.
+		int opposite = f < 4 ? (f + 2) % 4 : 9 - f;
+		if (!nc || !(nc->summary.opaque_faces & (1 << opposite))) return false;
 	}
+	return true;
+}
 
-	bool oob = check_bounds(nx, &cix, &nx) |
-	           check_bounds(ny, &ciy, &ny) |
-	           check_bounds(nz, &ciz, &nz);
-
-	if (oob && (cix < 0 || cix >= settings.render_distance ||
-	            ciy < 0 || ciy >= WORLD_HEIGHT ||
-	            ciz < 0 || ciz >= settings.render_distance))
-		return true;
-
-	Chunk *nb = &chunks[cix][ciy][ciz];
-	Block  cb = chunk->blocks[x][y][z];
-	Block  nb_blk = nb->blocks[nx][ny][nz];
-
-	uint8_t cur_type  = block_data[cb.id][0];
-	bool    cur_trans = block_data[cb.id][1] == 1;
-	bool    nb_trans  = block_data[nb_blk.id][1] == 1;
-
-	if (cur_type == BTYPE_LEAF) {
-		if (settings.fancy_graphics) return true;
-		if (nb_blk.id == 0) return true;
-		if (!cur_trans && !nb_trans) return false;
-		if (cur_trans && nb_trans) return cb.id != nb_blk.id;
-		return !cur_trans;
-	}
+// Caller holds the column locks around the chunk (column_lock_area).
+// Neighbours outside the render area read as air, unloaded neighbours keep
+// their ids but report full sky light.
+void snapshot_chunk(Chunk *chunk, chunk_snapshot_t *snap) {
+	snap->x = chunk->x;
+	snap->y = chunk->y;
+	snap->z = chunk->z;
+	memset(snap->id,    0,    sizeof(snap->id));
+	memset(snap->light, 0xF0, sizeof(snap->light));
+
+	uint8_t ids[CHUNK_SIZE][CHUNK_SIZE][CHUNK_SIZE];
+	uint8_t light[CHUNK_SIZE][CHUNK_SIZE][CHUNK_SIZE];
+	chunk_copy_ids(chunk, ids);
+	chunk_copy_light(chunk, light);
+	for (int x = 0; x < CHUNK_SIZE; x++)
+		for (int y = 0; y < CHUNK_SIZE; y++) {
+			memcpy(&snap->id   [x + 1][y + 1][1], ids  [x][y], CHUNK_SIZE);
+			memcpy(&snap->light[x + 1][y + 1][1], light[x][y], CHUNK_SIZE);
+		}
 
-	if (nb_blk.id == 0) return true;
-	if (!cur_trans && !nb_trans) return false;
-	uint8_t nb_type = block_data[nb_blk.id][0];
-	if (cur_trans && nb_trans) {
-		if (cur_type == BTYPE_LIQUID && nb_type == BTYPE_LIQUID) return false;
-		return cb.id != nb_blk.id;
+	const int last = CHUNK_SIZE - 1;
+	for (int f = 0; f < 6; f++) {
+		Chunk *nc = get_chunk(chunk->x + face_dx[f], chunk->y + face_dy[f], chunk->z + face_dz[f]);
+		if (!nc) continue;
+
+		for (int a = 0; a < CHUNK_SIZE; a++)
+			for (int b = 0; b < CHUNK_SIZE; b++) {
+				int sx, sy, sz, bx, by, bz;
+				switch (f) {
+					case 0:  sx = a + 1;          sy = b + 1;          sz = SNAPSHOT_SIZE - 1; bx = a;    by = b;    bz = 0;    break;
+					case 1:  sx = SNAPSHOT_SIZE - 1; sy = a + 1;       sz = b + 1;          bx = 0;    by = a;    bz = b;    break;
+					case 2:  sx = a + 1;          sy = b + 1;          sz = 0;              bx = a;    by = b;    bz = last; break;
+					case 3:  sx = 0;              sy = a + 1;          sz = b + 1;          bx = last; by = a;    bz = b;    break;
+					case 4:  sx = a + 1;          sy = 0;              sz = b + 1;          bx = a;    by = last; bz = b;    break;
+					default: sx = a + 1;          sy = SNAPSHOT_SIZE - 1; sz = b + 1;       bx = a;    by = 0;    bz = b;    break;
+				}
+				snap->id[sx][sy][sz] = chunk_get_id(nc, bx, by, bz);
+				if (nc->is_loaded)
+					snap->light[sx][sy][sz] = chunk_get_light(nc, bx, by, bz);
+			}
 	}
-	return !cur_trans;
 }
 
 void map_coordinates(uint8_t face, uint8_t u, uint8_t v, uint8_t d,
@@ -78,41 +86,9 @@ void map_coordinates(uint8_t face, uint8_t u, uint8_t v, uint8_t d,
 	}
 }
 
-uint8_t get_face_light(Chunk *chunk, int x, int y, int z, uint8_t face) {
-	static const int8_t ndx[] = { 0,  1,  0, -1,  0,  0 };
-	static const int8_t ndy[] = { 0,  0,  0,  0, -1,  1 };
-	static const int8_t ndz[] = { 1,  0, -1,  0,  0,  0 };
-
-	int nlx = x + ndx[face];
-	int nly = y + ndy[face];
-	int nlz = z + ndz[face];
-
-	uint8_t own = chunk->blocks[x][y][z].light_level;
-	uint8_t neighbor_light;
-
-	if (nlx >= 0 && nlx < CHUNK_SIZE &&
-	    nly >= 0 && nly < CHUNK_SIZE &&
-	    nlz >= 0 && nlz < CHUNK_SIZE) {
-		neighbor_light = chunk->blocks[nlx][nly][nlz].light_level;
-	} else {
-		int8_t cix = chunk->ci_x, ciy = chunk->ci_y, ciz = chunk->ci_z;
-		int8_t bx = nlx, by = nly, bz = nlz;
-		if (nlx < 0)          { cix--; bx = CHUNK_SIZE - 1; }
-		else if (nlx >= CHUNK_SIZE) { cix++; bx = 0; }
-		if (nly < 0)          { ciy--; by = CHUNK_SIZE - 1; }
-		else if (nly >= CHUNK_SIZE) { ciy++; by = 0; }
-		if (nlz < 0)          { ciz--; bz = CHUNK_SIZE - 1; }
-		else if (nlz >= CHUNK_SIZE) { ciz++; bz = 0; }
-
-		if (cix >= 0 && cix < settings.render_distance &&
-		    ciy >= 0 && ciy < WORLD_HEIGHT &&
-		    ciz >= 0 && ciz < settings.render_distance) {
-			Chunk *nc = &chunks[cix][ciy][ciz];
-			neighbor_light = nc->is_loaded ? nc->blocks[bx][by][bz].light_level : 0xF0;
-		} else {
-			neighbor_light = 0xF0;
-		}
-	}
+uint8_t get_face_light(const chunk_snapshot_t *snap, int x, int y, int z, uint8_t face) {
+	uint8_t own            = snap->light[x + 1][y + 1][z + 1];
+	uint8_t neighbor_light = snap->light[x + 1 + face_dx[face]][y + 1 + face_dy[face]][z + 1 + face_dz[face]];
 
 	uint8_t sky = SKY_LIGHT(neighbor_light),  blk = BLOCK_LIGHT(neighbor_light);
 	uint8_t osk = SKY_LIGHT(own),             obl = BLOCK_LIGHT(own);
@@ -121,58 +97,100 @@ uint8_t get_face_light(Chunk *chunk, int x, int y, int z, uint8_t face) {
 	return (sky << 4) | blk;
 }
 
-uint8_t find_width(Chunk *chunk, uint8_t face, uint8_t u, uint8_t v,
-                   uint8_t x, uint8_t y, uint8_t z,
-                   bool mask[CHUNK_SIZE][CHUNK_SIZE], Block *block) {
-	uint8_t width      = 1;
-	uint8_t block_type = block_data[block->id][0];
-	bool    fancy_leaf = (block_type == BTYPE_LEAF && settings.fancy_graphics);
-	uint8_t base_light = get_face_light(chunk, x, y, z, face);
-	uint8_t d_coord    = (face == 0 || face == 2) ? z : (face == 1 || face == 3) ? x : y;
-
-	for (uint8_t du = 1; u + du < CHUNK_SIZE; du++) {
-		if (mask[v][u + du]) break;
-		uint8_t nx, ny, nz;
-		map_coordinates(face, u + du, v, d_coord, &nx, &ny, &nz);
-		if (nx >= CHUNK_SIZE || ny >= CHUNK_SIZE || nz >= CHUNK_SIZE) break;
-		Block  *nb      = &chunk->blocks[nx][ny][nz];
-		uint8_t nb_type = block_data[nb->id][0];
-		if (nb->id != block->id) break;
-		if (block_type != BTYPE_REGULAR && block_type != BTYPE_LIQUID && block_type != BTYPE_LEAF) break;
-		if (nb_type != block_type) break;
-		if (!fancy_leaf && !is_face_visible(chunk, nx, ny, nz, face)) break;
-		if (get_face_light(chunk, nx, ny, nz, face) != base_light) break;
-		width++;
+// Rows along z for every (x, y) of the snapshot: bit z is the block at
+// snapshot [x][y][z], so bits 0 and 17 come from the halo. Two classes share
+// each word, the second in the upper half.
+typedef struct {
+	uint64_t solid_opaque[SNAPSHOT_SIZE][SNAPSHOT_SIZE];
+	uint64_t greedy_leaf [SNAPSHOT_SIZE][SNAPSHOT_SIZE];
+} row_masks_t;
+
+// Visible faces of a whole row at once, given the row of neighbours aligned
+// bit for bit. Translucent-against-translucent pairs depend on the actual ids
+// and are returned in *ambiguous instead. Results cover bits 1..16 only.
+static inline uint16_t row_visibility(uint64_t so, uint64_t gl, uint64_t nb_so, bool fancy, uint16_t *ambiguous) {
+	uint32_t opaque    = (uint32_t)(so >> 32);
+	uint32_t greedy    = (uint32_t)gl;
+	uint32_t leaf      = (uint32_t)(gl >> 32);
+	uint32_t nb_solid  = (uint32_t)nb_so;
+	uint32_t nb_trans  = nb_solid & ~(uint32_t)(nb_so >> 32);
+
+	uint32_t vis = greedy & (~nb_solid | (opaque & nb_trans));
+	uint32_t amb = greedy & ~opaque & nb_trans;
+	if (fancy) {
+		vis |= leaf;
+		amb &= ~leaf;
 	}
-	return width;
+	*ambiguous = (uint16_t)(amb >> 1);
+	return (uint16_t)(vis >> 1);
 }
 
-uint8_t find_height(Chunk *chunk, uint8_t face, uint8_t u, uint8_t v,
-                    uint8_t x, uint8_t y, uint8_t z,
-                    bool mask[CHUNK_SIZE][CHUNK_SIZE], Block *block, uint8_t width) {
-	uint8_t height     = 1;
-	uint8_t block_type = block_data[block->id][0];
-	bool    fancy_leaf = (block_type == BTYPE_LEAF && settings.fancy_graphics);
-	uint8_t base_light = get_face_light(chunk, x, y, z, face);
-	uint8_t d_coord    = (face == 0 || face == 2) ? z : (face == 1 || face == 3) ? x : y;
-
-	for (uint8_t dv = 1; v + dv < CHUNK_SIZE; dv++) {
-		bool ok = true;
-		for (uint8_t du = 0; du < width && ok; du++) {
-			if (mask[v + dv][u + du]) { ok = false; break; }
-			uint8_t nx, ny, nz;
-			map_coordinates(face, u + du, v + dv, d_coord, &nx, &ny, &nz);
-			if (nx >= CHUNK_SIZE || ny >= CHUNK_SIZE || nz >= CHUNK_SIZE) { ok = false; break; }
-			Block  *nb      = &chunk->blocks[nx][ny][nz];
-			uint8_t nb_type = block_data[nb->id][0];
-			if (nb->id != block->id) { ok = false; break; }
-			if (block_type != BTYPE_REGULAR && block_type != BTYPE_LIQUID && block_type != BTYPE_LEAF) { ok = false; break; }
-			if (nb_type != block_type) { ok = false; break; }
-			if (!fancy_leaf && !is_face_visible(chunk, nx, ny, nz, face)) { ok = false; break; }
-			if (get_face_light(chunk, nx, ny, nz, face) != base_light) { ok = false; break; }
+void build_face_masks(const chunk_snapshot_t *snap, face_masks_t *out) {
+	// Per-id bit 0 of each class, shifted into place for every cell.
+	uint64_t solid_opaque[MAX_BLOCK_TYPES], greedy_leaf[MAX_BLOCK_TYPES];
+	for (int id = 0; id < MAX_BLOCK_TYPES; id++) {
+		uint8_t bt     = block_data[id][0];
+		bool    solid  = id != 0;
+		bool    opaque = solid && block_data[id][1] == 0;
+		bool    greedy = solid && (bt == BTYPE_REGULAR || bt == BTYPE_LIQUID || bt == BTYPE_LEAF);
+		bool    leaf   = solid && bt == BTYPE_LEAF;
+		solid_opaque[id] = (uint64_t)solid  | (uint64_t)opaque << 32;
+		greedy_leaf[id]  = (uint64_t)greedy | (uint64_t)leaf   << 32;
+	}
+
+	row_masks_t m;
+	for (int x = 0; x < SNAPSHOT_SIZE; x++)
+		for (int y = 0; y < SNAPSHOT_SIZE; y++) {
+			uint64_t so = 0, gl = 0;
+			for (int z = 0; z < SNAPSHOT_SIZE; z++) {
+				uint8_t id = snap->id[x][y][z];
+				so |= solid_opaque[id] << z;
+				gl |= greedy_leaf[id]  << z;
+			}
+			m.solid_opaque[x][y] = so;
+			m.greedy_leaf [x][y] = gl;
+		}
+
+	memset(out, 0, sizeof(*out));
+	bool fancy = settings.fancy_graphics;
+
+	for (uint8_t face = 0; face < 6; face++) {
+		int dx = face_dx[face], dy = face_dy[face], dz = face_dz[face];
+
+		for (int x = 0; x < CHUNK_SIZE; x++) {
+			for (int y = 0; y < CHUNK_SIZE; y++) {
+				uint64_t so = m.solid_opaque[x + 1][y + 1];
+				uint64_t nb = m.solid_opaque[x + 1 + dx][y + 1 + dy];
+				if (dz > 0)      nb >>= 1;
+				else if (dz < 0) nb <<= 1;
+
+				uint16_t amb;
+				uint16_t vis = row_visibility(so, m.greedy_leaf[x + 1][y + 1], nb, fancy, &amb);
+
+				// Translucent pairs: hidden between liquids, otherwise only
+				// between different ids.
+				while (amb) {
+					int z = __builtin_ctz(amb);
+					amb &= amb - 1;
+					uint8_t cur = snap->id[x + 1][y + 1][z + 1];
+					uint8_t nid = snap->id[x + 1 + dx][y + 1 + dy][z + 1 + dz];
+					if (block_data[cur][0] == BTYPE_LIQUID && block_data[nid][0] == BTYPE_LIQUID) continue;
+					if (cur != nid) vis |= (uint16_t)(1u << z);
+				}
+
+				// Faces 1/3 already run along u = z; the others take one
+				// bit per z into rows indexed by their own d and v.
+				if (face == 1 || face == 3) {
+					out->rows[face][x][y] = vis;
+					continue;
+				}
+				while (vis) {
+					int z = __builtin_ctz(vis);
+					vis &= vis - 1;
+					if (face >= 4) out->rows[face][y][z] |= (uint16_t)(1u << x); // u=x, v=z, d=y
+					else           out->rows[face][z][y] |= (uint16_t)(1u << x); // u=x, v=y, d=z
+				}
+			}
 		}
-		if (!ok) break;
-		height++;
 	}
-	return height;
 }
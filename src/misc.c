@@ -92,20 +92,21 @@ void do_time_stuff(void) {
 
 		uint32_t total_ov = 0, total_oi = 0, total_tv = 0, total_ti = 0;
 		uint32_t loaded = 0, visible = 0;
+		// Mesh workers swap meshes in under the column lock.
 		for (int x = 0; x < settings.render_distance; x++) {
-			for (int y = 0; y < WORLD_HEIGHT; y++) {
-				for (int z = 0; z < settings.render_distance; z++) {
-					Chunk *c = &chunks[x][y][z];
+			for (int z = 0; z < settings.render_distance; z++) {
+				column_read_lock(x, z);
+				for (int y = 0; y < WORLD_HEIGHT; y++) {
+					Chunk *c = chunks[x][y][z];
 					if (c->is_loaded) loaded++;
 					if (visibility_map[x][y][z]) visible++;
 					if (!visibility_map[x][y][z]) continue;
-					for (int f = 0; f < 6; f++) {
-						total_ov += c->faces[f].vertex_count;
-						total_oi += c->faces[f].index_count;
-						total_tv += c->transparent_faces[f].vertex_count;
-						total_ti += c->transparent_faces[f].index_count;
-					}
+					total_ov += c->mesh.vertex_count[0];
+					total_oi += QUAD_INDEX_COUNT(c->mesh.vertex_count[0]);
+					total_tv += c->mesh.vertex_count[1];
+					total_ti += QUAD_INDEX_COUNT(c->mesh.vertex_count[1]);
 				}
+				column_unlock(x, z);
 			}
 		}
 
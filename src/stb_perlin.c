@@ -1,9 +1,11 @@
 #include "stb_perlin.h"
 #include <math.h>
+#include <stdint.h>
 
 // not same permutation table as Perlin's reference to avoid copyright issues;
 // Perlin's table can be found at http://mrl.nyu.edu/~perlin/noise/
-static unsigned char stb__perlin_randtab[512] =
+// +3 padding so the 32-bit gathers in the batched path never read past the end
+static unsigned char stb__perlin_randtab[512 + 3] =
 {
    23, 125, 161, 52, 103, 117, 70, 37, 247, 101, 203, 169, 124, 126, 44, 123,
    152, 238, 145, 45, 171, 114, 253, 10, 192, 136, 4, 157, 249, 30, 35, 72,
@@ -41,7 +43,7 @@ static unsigned char stb__perlin_randtab[512] =
    61, 40, 167, 237, 102, 223, 106, 159, 197, 189, 215, 137, 36, 32, 22, 5,
 };
 
-static unsigned char stb__perlin_randtab_grad_idx[512] =
+static unsigned char stb__perlin_randtab_grad_idx[512 + 3] =
 {
    7, 9, 5, 0, 11, 1, 6, 9, 3, 9, 11, 1, 8, 10, 4, 7,
    8, 6, 1, 5, 3, 10, 9, 10, 0, 8, 4, 1, 5, 2, 7, 8,
@@ -284,4 +286,257 @@ float stb_perlin_noise3_wrap_nonpow2(float x, float y, float z, int x_wrap, int
    n1 = stb__perlin_lerp(n10,n11,v);
 
    return stb__perlin_lerp(n0,n1,u);
-}
\ No newline at end of file
+}
+
+// Batched evaluation, not part of upstream stb. Same lattice, tables and
+// operation order as stb_perlin_noise3 without wrapping, so every lane matches
+// the scalar call. Lanes run on AVX2 (8 wide, gathered table lookups), NEON or
+// SSE2 (4 wide); leftovers and other targets fall back to the scalar path.
+
+static const float perlin_basis_x[12] = { 1,-1, 1,-1, 1,-1, 1,-1, 0, 0, 0, 0 };
+static const float perlin_basis_y[12] = { 1, 1,-1,-1, 0, 0, 0, 0, 1,-1, 1,-1 };
+static const float perlin_basis_z[12] = { 0, 0, 0, 0, 1, 1,-1,-1, 1, 1,-1,-1 };
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PERLIN_LANES 8
+typedef __m256  pf_t;
+typedef __m256i pi_t;
+#define pf_load(p)    _mm256_loadu_ps(p)
+#define pf_store(p,v) _mm256_storeu_ps(p, v)
+#define pf_set(f)     _mm256_set1_ps(f)
+#define pf_add(a,b)   _mm256_add_ps(a, b)
+#define pf_sub(a,b)   _mm256_sub_ps(a, b)
+#define pf_mul(a,b)   _mm256_mul_ps(a, b)
+#define pi_set(i)     _mm256_set1_epi32(i)
+#define pi_add(a,b)   _mm256_add_epi32(a, b)
+#define pi_and(a,b)   _mm256_and_si256(a, b)
+#define pi_to_pf(a)   _mm256_cvtepi32_ps(a)
+
+static inline pi_t pf_floor(pf_t a) {
+	pi_t ai = _mm256_cvttps_epi32(a);
+	pf_t lt = _mm256_cmp_ps(a, _mm256_cvtepi32_ps(ai), _CMP_LT_OQ);
+	return _mm256_add_epi32(ai, _mm256_castps_si256(lt));
+}
+
+static inline pi_t perlin_lookup(const unsigned char* table, pi_t idx) {
+	return _mm256_and_si256(_mm256_i32gather_epi32((const int*)table, idx, 1), _mm256_set1_epi32(255));
+}
+
+static inline void perlin_basis(pi_t g, pf_t* gx, pf_t* gy, pf_t* gz) {
+	*gx = _mm256_i32gather_ps(perlin_basis_x, g, 4);
+	*gy = _mm256_i32gather_ps(perlin_basis_y, g, 4);
+	*gz = _mm256_i32gather_ps(perlin_basis_z, g, 4);
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PERLIN_LANES 4
+typedef float32x4_t pf_t;
+typedef int32x4_t   pi_t;
+#define pf_load(p)    vld1q_f32(p)
+#define pf_store(p,v) vst1q_f32(p, v)
+#define pf_set(f)     vdupq_n_f32(f)
+#define pf_add(a,b)   vaddq_f32(a, b)
+#define pf_sub(a,b)   vsubq_f32(a, b)
+#define pf_mul(a,b)   vmulq_f32(a, b)
+#define pi_load(p)    vld1q_s32(p)
+#define pi_store(p,v) vst1q_s32(p, v)
+#define pi_set(i)     vdupq_n_s32(i)
+#define pi_add(a,b)   vaddq_s32(a, b)
+#define pi_and(a,b)   vandq_s32(a, b)
+#define pi_to_pf(a)   vcvtq_f32_s32(a)
+
+static inline pi_t pf_floor(pf_t a) {
+	pi_t ai = vcvtq_s32_f32(a);
+	uint32x4_t lt = vcltq_f32(a, vcvtq_f32_s32(ai));
+	return vaddq_s32(ai, vreinterpretq_s32_u32(lt));
+}
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PERLIN_LANES 4
+typedef __m128  pf_t;
+typedef __m128i pi_t;
+#define pf_load(p)    _mm_loadu_ps(p)
+#define pf_store(p,v) _mm_storeu_ps(p, v)
+#define pf_set(f)     _mm_set1_ps(f)
+#define pf_add(a,b)   _mm_add_ps(a, b)
+#define pf_sub(a,b)   _mm_sub_ps(a, b)
+#define pf_mul(a,b)   _mm_mul_ps(a, b)
+#define pi_load(p)    _mm_loadu_si128((const __m128i*)(p))
+#define pi_store(p,v) _mm_storeu_si128((__m128i*)(p), v)
+#define pi_set(i)     _mm_set1_epi32(i)
+#define pi_add(a,b)   _mm_add_epi32(a, b)
+#define pi_and(a,b)   _mm_and_si128(a, b)
+#define pi_to_pf(a)   _mm_cvtepi32_ps(a)
+
+static inline pi_t pf_floor(pf_t a) {
+	pi_t ai = _mm_cvttps_epi32(a);
+	pf_t lt = _mm_cmplt_ps(a, _mm_cvtepi32_ps(ai));
+	return _mm_add_epi32(ai, _mm_castps_si128(lt));
+}
+#endif
+
+// No gathers on NEON/SSE2, the table lookups go through memory lane by lane.
+#if defined(PERLIN_LANES) && !defined(__AVX2__)
+static inline pi_t perlin_lookup(const unsigned char* table, pi_t idx) {
+	int32_t lanes[PERLIN_LANES];
+	pi_store(lanes, idx);
+	for (int l = 0; l < PERLIN_LANES; l++) lanes[l] = table[lanes[l]];
+	return pi_load(lanes);
+}
+
+static inline void perlin_basis(pi_t g, pf_t* gx, pf_t* gy, pf_t* gz) {
+	int32_t lanes[PERLIN_LANES];
+	float x[PERLIN_LANES], y[PERLIN_LANES], z[PERLIN_LANES];
+	pi_store(lanes, g);
+	for (int l = 0; l < PERLIN_LANES; l++) {
+		x[l] = perlin_basis_x[lanes[l]];
+		y[l] = perlin_basis_y[lanes[l]];
+		z[l] = perlin_basis_z[lanes[l]];
+	}
+	*gx = pf_load(x);
+	*gy = pf_load(y);
+	*gz = pf_load(z);
+}
+#endif
+
+#ifdef PERLIN_LANES
+static inline pf_t perlin_ease_lanes(pf_t a) {
+	pf_t e = pf_add(pf_mul(pf_sub(pf_mul(a, pf_set(6.f)), pf_set(15.f)), a), pf_set(10.f));
+	return pf_mul(pf_mul(pf_mul(e, a), a), a);
+}
+
+static inline pf_t perlin_lerp_lanes(pf_t a, pf_t b, pf_t t) {
+	return pf_add(a, pf_mul(pf_sub(b, a), t));
+}
+
+static inline pf_t perlin_grad_lanes(pi_t hash, pf_t x, pf_t y, pf_t z) {
+	pf_t gx, gy, gz;
+	perlin_basis(perlin_lookup(stb__perlin_randtab_grad_idx, hash), &gx, &gy, &gz);
+	return pf_add(pf_add(pf_mul(gx, x), pf_mul(gy, y)), pf_mul(gz, z));
+}
+
+static inline pf_t perlin_grad2_lanes(pi_t hash, pf_t x, pf_t z) {
+	pf_t gx, gy, gz;
+	perlin_basis(perlin_lookup(stb__perlin_randtab_grad_idx, hash), &gx, &gy, &gz);
+	return pf_add(pf_mul(gx, x), pf_mul(gz, z));
+}
+
+static pf_t perlin_noise3_lanes(pf_t x, pf_t y, pf_t z, pi_t seed) {
+	pi_t mask = pi_set(255), one = pi_set(1);
+	pi_t px = pf_floor(x), py = pf_floor(y), pz = pf_floor(z);
+	pi_t x0 = pi_and(px, mask), x1 = pi_and(pi_add(px, one), mask);
+	pi_t y0 = pi_and(py, mask), y1 = pi_and(pi_add(py, one), mask);
+	pi_t z0 = pi_and(pz, mask), z1 = pi_and(pi_add(pz, one), mask);
+
+	x = pf_sub(x, pi_to_pf(px)); pf_t u = perlin_ease_lanes(x);
+	y = pf_sub(y, pi_to_pf(py)); pf_t v = perlin_ease_lanes(y);
+	z = pf_sub(z, pi_to_pf(pz)); pf_t w = perlin_ease_lanes(z);
+	pf_t xm = pf_sub(x, pf_set(1.f)), ym = pf_sub(y, pf_set(1.f)), zm = pf_sub(z, pf_set(1.f));
+
+	pi_t r0 = perlin_lookup(stb__perlin_randtab, pi_add(x0, seed));
+	pi_t r1 = perlin_lookup(stb__perlin_randtab, pi_add(x1, seed));
+	pi_t r00 = perlin_lookup(stb__perlin_randtab, pi_add(r0, y0));
+	pi_t r01 = perlin_lookup(stb__perlin_randtab, pi_add(r0, y1));
+	pi_t r10 = perlin_lookup(stb__perlin_randtab, pi_add(r1, y0));
+	pi_t r11 = perlin_lookup(stb__perlin_randtab, pi_add(r1, y1));
+
+	pf_t n00 = perlin_lerp_lanes(perlin_grad_lanes(pi_add(r00, z0), x, y, z), perlin_grad_lanes(pi_add(r00, z1), x, y, zm), w);
+	pf_t n01 = perlin_lerp_lanes(perlin_grad_lanes(pi_add(r01, z0), x, ym, z), perlin_grad_lanes(pi_add(r01, z1), x, ym, zm), w);
+	pf_t n10 = perlin_lerp_lanes(perlin_grad_lanes(pi_add(r10, z0), xm, y, z), perlin_grad_lanes(pi_add(r10, z1), xm, y, zm), w);
+	pf_t n11 = perlin_lerp_lanes(perlin_grad_lanes(pi_add(r11, z0), xm, ym, z), perlin_grad_lanes(pi_add(r11, z1), xm, ym, zm), w);
+
+	pf_t n0 = perlin_lerp_lanes(n00, n01, v);
+	pf_t n1 = perlin_lerp_lanes(n10, n11, v);
+	return perlin_lerp_lanes(n0, n1, u);
+}
+
+// y = 0 collapses the lattice to the four y0 corners and v to 0.
+static pf_t perlin_noise2_lanes(pf_t x, pf_t z) {
+	pi_t mask = pi_set(255), one = pi_set(1);
+	pi_t px = pf_floor(x), pz = pf_floor(z);
+	pi_t x0 = pi_and(px, mask), x1 = pi_and(pi_add(px, one), mask);
+	pi_t z0 = pi_and(pz, mask), z1 = pi_and(pi_add(pz, one), mask);
+
+	x = pf_sub(x, pi_to_pf(px)); pf_t u = perlin_ease_lanes(x);
+	z = pf_sub(z, pi_to_pf(pz)); pf_t w = perlin_ease_lanes(z);
+	pf_t xm = pf_sub(x, pf_set(1.f)), zm = pf_sub(z, pf_set(1.f));
+
+	pi_t r00 = perlin_lookup(stb__perlin_randtab, perlin_lookup(stb__perlin_randtab, x0));
+	pi_t r10 = perlin_lookup(stb__perlin_randtab, perlin_lookup(stb__perlin_randtab, x1));
+
+	pf_t n0 = perlin_lerp_lanes(perlin_grad2_lanes(pi_add(r00, z0), x, z), perlin_grad2_lanes(pi_add(r00, z1), x, zm), w);
+	pf_t n1 = perlin_lerp_lanes(perlin_grad2_lanes(pi_add(r10, z0), xm, z), perlin_grad2_lanes(pi_add(r10, z1), xm, zm), w);
+	return perlin_lerp_lanes(n0, n1, u);
+}
+#endif
+
+float perlin_noise2(float x, float z)
+{
+	int px = stb__perlin_fastfloor(x);
+	int pz = stb__perlin_fastfloor(z);
+	int x0 = px & 255, x1 = (px+1) & 255;
+	int z0 = pz & 255, z1 = (pz+1) & 255;
+
+	x -= px; float u = stb__perlin_ease(x);
+	z -= pz; float w = stb__perlin_ease(z);
+
+	int r00 = stb__perlin_randtab[stb__perlin_randtab[x0]];
+	int r10 = stb__perlin_randtab[stb__perlin_randtab[x1]];
+	int g000 = stb__perlin_randtab_grad_idx[r00+z0], g001 = stb__perlin_randtab_grad_idx[r00+z1];
+	int g100 = stb__perlin_randtab_grad_idx[r10+z0], g101 = stb__perlin_randtab_grad_idx[r10+z1];
+
+	float n0 = stb__perlin_lerp(perlin_basis_x[g000]*x + perlin_basis_z[g000]*z,
+	                            perlin_basis_x[g001]*x + perlin_basis_z[g001]*(z-1), w);
+	float n1 = stb__perlin_lerp(perlin_basis_x[g100]*(x-1) + perlin_basis_z[g100]*z,
+	                            perlin_basis_x[g101]*(x-1) + perlin_basis_z[g101]*(z-1), w);
+	return stb__perlin_lerp(n0, n1, u);
+}
+
+void perlin_noise2_batch(const float* x, const float* z, float* out, int count)
+{
+	int i = 0;
+#ifdef PERLIN_LANES
+	for (; i + PERLIN_LANES <= count; i += PERLIN_LANES)
+		pf_store(out + i, perlin_noise2_lanes(pf_load(x + i), pf_load(z + i)));
+#endif
+	for (; i < count; i++)
+		out[i] = perlin_noise2(x[i], z[i]);
+}
+
+void perlin_noise3_batch(const float* x, const float* y, const float* z, float* out, int count)
+{
+	int i = 0;
+#ifdef PERLIN_LANES
+	for (; i + PERLIN_LANES <= count; i += PERLIN_LANES)
+		pf_store(out + i, perlin_noise3_lanes(pf_load(x + i), pf_load(y + i), pf_load(z + i), pi_set(0)));
+#endif
+	for (; i < count; i++)
+		out[i] = stb_perlin_noise3_internal(x[i], y[i], z[i], 0, 0, 0, 0);
+}
+
+void perlin_fbm_noise3_batch(const float* x, const float* y, const float* z, float* out, int count,
+                             float lacunarity, float gain, int octaves)
+{
+	int i = 0;
+#ifdef PERLIN_LANES
+	for (; i + PERLIN_LANES <= count; i += PERLIN_LANES) {
+		pf_t px = pf_load(x + i), py = pf_load(y + i), pz = pf_load(z + i);
+		pf_t sum = pf_set(0.f);
+		float frequency = 1.0f;
+		float amplitude = 1.0f;
+		for (int o = 0; o < octaves; o++) {
+			pf_t f = pf_set(frequency);
+			pf_t n = perlin_noise3_lanes(pf_mul(px, f), pf_mul(py, f), pf_mul(pz, f), pi_set((unsigned char)o));
+			sum = pf_add(sum, pf_mul(n, pf_set(amplitude)));
+			frequency *= lacunarity;
+			amplitude *= gain;
+		}
+		pf_store(out + i, sum);
+	}
+#endif
+	for (; i < count; i++)
+		out[i] = stb_perlin_fbm_noise3(x[i], y[i], z[i], lacunarity, gain, octaves);
+}
@@ -66,4 +66,12 @@ uint8_t block_data[MAX_BLOCK_TYPES][8] = {
 	[89] = {BTYPE_REGULAR,	0, 106, 106, 106, 106, 106, 106},	// Glowstone
 	[91] = {BTYPE_REGULAR,	0, 121, 119, 119, 119, 103, 103},	// Jack o lantern
 	[95] = {BTYPE_REGULAR,	0, 28,  27,  27,  27,  26,  26 },	// Chest
-};
\ No newline at end of file
+};
+
+// Block light emitted by an id, 0 for everything that does not glow.
+uint8_t block_emission(uint8_t id) {
+	switch (id) {
+		case 10: case 11: case 89: return 15;
+		default: return 0;
+	}
+}
@@ -3,13 +3,13 @@
 #include "world.h"
 #include "config.h"
 #include <math.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <time.h>
 
-void relight_chunk(Chunk *chunk);
-void init_column_lighting(Chunk col[WORLD_HEIGHT]);
+void init_column_lighting(Chunk col[WORLD_HEIGHT], const column_context_t* ctx);
 
 _Atomic int world_offset_x = 0;
 _Atomic int world_offset_z = 0;
@@ -31,7 +31,6 @@ typedef struct {
 	int capacity;
 	int size;
 	pthread_mutex_t mutex;
-	pthread_cond_t cond;
 } column_load_queue_t;
 
 typedef struct {
@@ -42,15 +41,35 @@ typedef struct {
 } world_gen_tracker_t;
 
 static column_load_queue_t column_load_queue;
-#define NUM_GEN_THREADS 4
-static pthread_t world_gen_threads[NUM_GEN_THREADS];
-bool world_gen_thread_running = false;
-pthread_mutex_t chunks_mutex = PTHREAD_MUTEX_INITIALIZER;
 static world_gen_tracker_t world_gen_tracker = {0};
 
 static bool* chunk_needs_load_cache = NULL;
 static size_t cache_size = 0;
 
+// Columns that are queued or being generated, one entry per ring slot.
+// A slot maps to exactly one world column inside the window, so this is a
+// set keyed by world column. Guarded by column_load_queue.mutex.
+typedef struct {
+	int cx, cz;
+	bool pending;
+} column_inflight_t;
+static column_inflight_t* column_inflight = NULL;
+
+// Requests per ring slot that are queued or being generated; mesh jobs wait
+// on the counters around their column (mesh_column_deps).
+static job_counter_t* column_pending = NULL;
+
+// Columns swapped out of the grid, waiting for release_retired_columns.
+// Their mesh flags stay guarded by the lock of the slot they left.
+typedef struct {
+	Chunk* column;
+	int x, z;
+} retired_column_t;
+static retired_column_t* retired_columns = NULL;
+static int retired_count = 0;
+static int retired_capacity = 0;
+static pthread_mutex_t retired_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 void init_world_gen_tracker() {
 	pthread_mutex_init(&world_gen_tracker.mutex, NULL);
 	world_gen_tracker.tracking_active = false;
@@ -93,164 +112,468 @@ void track_chunk_completed() {
 }
 
 static void init_column_load_queue() {
-	column_load_queue.capacity = 256;
 	column_load_queue.size = 0;
-	column_load_queue.requests = malloc(column_load_queue.capacity * sizeof(column_load_request_t));
+	column_load_queue.requests = malloc(256 * sizeof(column_load_request_t));
+	column_load_queue.capacity = column_load_queue.requests ? 256 : 0;
 	pthread_mutex_init(&column_load_queue.mutex, NULL);
-	pthread_cond_init(&column_load_queue.cond, NULL);
 
+	// Counters are initialized once per allocation and destroyed with it;
+	// a reused allocation keeps its idle counters.
 	size_t total = settings.render_distance * settings.render_distance;
 	if (cache_size < total) {
+		for (size_t i = 0; i < cache_size; i++)
+			job_counter_destroy(&column_pending[i]);
 		free(chunk_needs_load_cache);
+		free(column_inflight);
+		free(column_pending);
 		chunk_needs_load_cache = malloc(total * sizeof(bool));
+		column_inflight = malloc(total * sizeof(column_inflight_t));
+		column_pending = malloc(total * sizeof(job_counter_t));
+		for (size_t i = 0; i < total; i++)
+			job_counter_init(&column_pending[i]);
 		cache_size = total;
 	}
+	memset(column_inflight, 0, total * sizeof(column_inflight_t));
+}
+
+// The queue is a binary min-heap on priority (squared distance to the
+// player), so the nearest column is always requests[0].
+static void column_heap_sift_up(int i) {
+	column_load_request_t *heap = column_load_queue.requests;
+	column_load_request_t item = heap[i];
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+		if (heap[parent].priority <= item.priority) break;
+		heap[i] = heap[parent];
+		i = parent;
+	}
+	heap[i] = item;
 }
 
-static void enqueue_column(int ci_x, int ci_z, int cx, int cz, float priority) {
+static void column_heap_sift_down(int i) {
+	column_load_request_t *heap = column_load_queue.requests;
+	int size = column_load_queue.size;
+	column_load_request_t item = heap[i];
+	for (;;) {
+		int child = 2 * i + 1;
+		if (child >= size) break;
+		if (child + 1 < size && heap[child + 1].priority < heap[child].priority) child++;
+		if (item.priority <= heap[child].priority) break;
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = item;
+}
+
+static column_inflight_t* column_inflight_entry(int ci_x, int ci_z) {
+	return &column_inflight[(size_t)ci_x * settings.render_distance + ci_z];
+}
+
+static job_counter_t* column_pending_entry(int ci_x, int ci_z) {
+	return &column_pending[(size_t)ci_x * settings.render_distance + ci_z];
+}
+
+// Pending-request counters of the in-window columns within two steps of
+// column (cx, cz). Its neighbours are only relit once their own neighbours
+// are in, and each relight marks the column again, so meshing after these
+// drain builds it once rather than once per arriving column.
+int mesh_column_deps(int cx, int cz, job_counter_t* deps[MESH_COLUMN_DEPS]) {
+	int count = 0;
+	for (int dx = -2; dx <= 2; dx++) {
+		for (int dz = -2; dz <= 2; dz++) {
+			int dist = abs(dx) + abs(dz);
+			if (dist == 0 || dist > 2 || !is_chunk_in_bounds(cx + dx, 0, cz + dz)) continue;
+			deps[count++] = column_pending_entry(chunk_slot(cx + dx), chunk_slot(cz + dz));
+		}
+	}
+	return count;
+}
+
+// Clear the in-flight mark for a finished or cancelled request, unless the
+// slot has since been claimed by a newer column. Caller holds the queue mutex.
+static void clear_column_inflight(const column_load_request_t *req) {
+	column_inflight_t *entry = column_inflight_entry(req->ci_x, req->ci_z);
+	if (entry->pending && entry->cx == req->cx && entry->cz == req->cz)
+		entry->pending = false;
+}
+
+static void finish_column_request(const column_load_request_t *req) {
 	pthread_mutex_lock(&column_load_queue.mutex);
+	clear_column_inflight(req);
+	pthread_mutex_unlock(&column_load_queue.mutex);
+	job_counter_done(column_pending_entry(req->ci_x, req->ci_z));
+	track_chunk_completed();
+}
+
+static void generate_column_job(void* arg, int worker);
+
+// Takes requests[i] out of the heap. Caller holds the queue mutex.
+static column_load_request_t column_heap_remove(int i) {
+	column_load_request_t req = column_load_queue.requests[i];
+	column_load_queue.requests[i] = column_load_queue.requests[--column_load_queue.size];
+	if (i < column_load_queue.size) {
+		column_heap_sift_down(i);
+		column_heap_sift_up(i);
+	}
+	return req;
+}
+
+// Returns false if the column is already queued or being generated.
+static bool enqueue_column(int ci_x, int ci_z, int cx, int cz, float priority) {
+	pthread_mutex_lock(&column_load_queue.mutex);
+	column_inflight_t *entry = column_inflight_entry(ci_x, ci_z);
+	if (entry->pending && entry->cx == cx && entry->cz == cz) {
+		pthread_mutex_unlock(&column_load_queue.mutex);
+		return false;
+	}
+
+	// Grow before marking anything, so failing leaves nothing to undo.
 	if (column_load_queue.size >= column_load_queue.capacity) {
-		column_load_queue.capacity *= 2;
-		column_load_queue.requests = realloc(column_load_queue.requests,
-			column_load_queue.capacity * sizeof(column_load_request_t));
+		int capacity = column_load_queue.capacity ? column_load_queue.capacity * 2 : 256;
+		column_load_request_t *requests = realloc(column_load_queue.requests,
+			capacity * sizeof(column_load_request_t));
+		if (!requests) {
+			pthread_mutex_unlock(&column_load_queue.mutex);
+			fprintf(stderr, "Failed to grow column load queue\n");
+			return false;
+		}
+		column_load_queue.requests = requests;
+		column_load_queue.capacity = capacity;
 	}
+	*entry = (column_inflight_t){ cx, cz, true };
 	column_load_request_t *req = &column_load_queue.requests[column_load_queue.size++];
 	req->ci_x = ci_x;
 	req->ci_z = ci_z;
 	req->cx = cx;
 	req->cz = cz;
 	req->priority = priority;
-	pthread_cond_signal(&column_load_queue.cond);
+	column_heap_sift_up(column_load_queue.size - 1);
+	job_counter_add(column_pending_entry(ci_x, ci_z), 1);
 	pthread_mutex_unlock(&column_load_queue.mutex);
-}
 
-// Generate all WORLD_HEIGHT chunks for a column, light them, then install.
-// Running terrain gen outside chunks_mutex allows true parallelism.
-void* world_gen_thread_func(void* arg) {
-	while (world_gen_thread_running) {
-		pthread_mutex_lock(&column_load_queue.mutex);
-		while (column_load_queue.size == 0 && world_gen_thread_running)
-			pthread_cond_wait(&column_load_queue.cond, &column_load_queue.mutex);
-		if (!world_gen_thread_running) {
-			pthread_mutex_unlock(&column_load_queue.mutex);
+	// Each job generates whichever queued column is nearest when it runs.
+	if (job_submit(generate_column_job, NULL, JOB_PRIORITY_LOW))
+		return true;
+
+	// Every queued request needs a job. Withdraw this one, or if a job
+	// already took it, the last one in the heap; that column is requested
+	// again on a later load pass.
+	pthread_mutex_lock(&column_load_queue.mutex);
+	if (column_load_queue.size == 0) {
+		pthread_mutex_unlock(&column_load_queue.mutex);
+		return false;
+	}
+	int i = column_load_queue.size - 1;
+	for (int j = 0; j < column_load_queue.size; j++) {
+		const column_load_request_t *r = &column_load_queue.requests[j];
+		if (r->ci_x == ci_x && r->ci_z == ci_z && r->cx == cx && r->cz == cz) {
+			i = j;
 			break;
 		}
+	}
+	column_load_request_t withdrawn = column_heap_remove(i);
+	clear_column_inflight(&withdrawn);
+	pthread_mutex_unlock(&column_load_queue.mutex);
+	job_counter_done(column_pending_entry(withdrawn.ci_x, withdrawn.ci_z));
+	return false;
+}
 
-		// Dequeue highest-priority (lowest dist) column.
-		int best = 0;
-		for (int i = 1; i < column_load_queue.size; i++) {
-			if (column_load_queue.requests[i].priority < column_load_queue.requests[best].priority)
-				best = i;
-		}
-		column_load_request_t req = column_load_queue.requests[best];
-		column_load_queue.requests[best] = column_load_queue.requests[--column_load_queue.size];
-		pthread_mutex_unlock(&column_load_queue.mutex);
+static column_load_request_t dequeue_column() {
+	return column_heap_remove(0);
+}
 
-		// Validate slot still maps to the same world position (player may have scrolled).
-		int current_offset_x = (int)atomic_load(&world_offset_x);
-		int current_offset_z = (int)atomic_load(&world_offset_z);
-		if (req.ci_x != req.cx - current_offset_x || req.ci_z != req.cz - current_offset_z) {
-			track_chunk_completed();
+// Cancel pending columns that scrolled out of the window, re-key the rest
+// on the player's new position and rebuild the heap, so columns near where
+// the player is now come before ones queued earlier.
+static void reprioritize_columns(float entity_chunk_x, float entity_chunk_z) {
+	int cancelled = 0;
+	pthread_mutex_lock(&column_load_queue.mutex);
+	int kept = 0;
+	for (int i = 0; i < column_load_queue.size; i++) {
+		column_load_request_t req = column_load_queue.requests[i];
+		if (!is_chunk_in_bounds(req.cx, 0, req.cz)) {
+			clear_column_inflight(&req);
+			job_counter_done(column_pending_entry(req.ci_x, req.ci_z));
+			cancelled++;
 			continue;
 		}
+		float wdx = req.cx - entity_chunk_x;
+		float wdz = req.cz - entity_chunk_z;
+		req.priority = wdx*wdx + wdz*wdz;
+		column_load_queue.requests[kept++] = req;
+	}
+	column_load_queue.size = kept;
+	for (int i = column_load_queue.size / 2 - 1; i >= 0; i--)
+		column_heap_sift_down(i);
+	pthread_mutex_unlock(&column_load_queue.mutex);
 
-		// --- Terrain generation (outside chunks_mutex) ---
-		// Generate all WORLD_HEIGHT chunks for this column.
-		Chunk temp_chunks[WORLD_HEIGHT];
-		memset(temp_chunks, 0, sizeof(temp_chunks));
+	while (cancelled-- > 0)
+		track_chunk_completed();
+}
+
+static void set_chunk_position(Chunk* chunk, unsigned char ci_x, unsigned char ci_y, unsigned char ci_z, int cx, int cy, int cz) {
+	chunk->ci_x = ci_x;
+	chunk->ci_y = ci_y;
+	chunk->ci_z = ci_z;
+	chunk->x = cx;
+	chunk->y = cy;
+	chunk->z = cz;
+	chunk->needs_update = true;
+	chunk->lighting_changed = true;
+}
+
+// Puts column into ring slot (x, z) and retires the column it replaces.
+// Ring slots outlive the columns they hold, so the GL objects (re-uploaded
+// into by the main thread) and a queued mesh job's claim move over to the
+// new chunks. A mesh job still building an old chunk finishes into it and
+// stops, as the old chunk is no longer loaded. Caller holds the slot's
+// column lock and the window lock.
+static void swap_column(int x, int z, Chunk* column) {
+	Chunk* old = chunks[x][0][z];
+	for (int cy = 0; cy < WORLD_HEIGHT; cy++) {
+		Chunk* slot = chunks[x][cy][z];
+		Chunk* chunk = &column[cy];
+		chunk->opaque_vao        = slot->opaque_vao;
+		chunk->opaque_vbo        = slot->opaque_vbo;
+		chunk->transparent_vao   = slot->transparent_vao;
+		chunk->transparent_vbo   = slot->transparent_vbo;
+		chunk->gpu_buffers_valid = slot->gpu_buffers_valid;
+		chunk->mesh_queued       = slot->mesh_queued;
+		slot->is_loaded = false;
+		chunks[x][cy][z] = chunk;
+	}
+
+	pthread_mutex_lock(&retired_mutex);
+	if (retired_count == retired_capacity) {
+		int capacity = retired_capacity ? retired_capacity * 2 : 64;
+		retired_column_t* retired = realloc(retired_columns, capacity * sizeof(retired_column_t));
+		if (!retired) {
+			// Leaking the column beats freeing it under a running mesh job.
+			pthread_mutex_unlock(&retired_mutex);
+			fprintf(stderr, "Failed to retire chunk column\n");
+			return;
+		}
+		retired_columns = retired;
+		retired_capacity = capacity;
+	}
+	retired_columns[retired_count++] = (retired_column_t){ old, x, z };
+	pthread_mutex_unlock(&retired_mutex);
+}
+
+static bool column_is_busy(const Chunk* column) {
+	for (int cy = 0; cy < WORLD_HEIGHT; cy++)
+		if (column[cy].mesh_busy)
+			return true;
+	return false;
+}
+
+// Returns retired columns to the pool once no mesh job is building one of
+// their chunks. Runs on the main thread, which also reads face data for
+// uploads, so nothing it may still be reading is freed under it. It is the
+// only thread that removes entries, so a copy taken under retired_mutex stays
+// valid while the column locks are taken without it.
+void release_retired_columns() {
+	retired_column_t candidates[64];
+	pthread_mutex_lock(&retired_mutex);
+	int candidate_count = retired_count < 64 ? retired_count : 64;
+	if (candidate_count)
+		memcpy(candidates, retired_columns, candidate_count * sizeof(retired_column_t));
+	pthread_mutex_unlock(&retired_mutex);
+
+	int released_count = 0;
+	for (int i = 0; i < candidate_count; i++) {
+		column_read_lock(candidates[i].x, candidates[i].z);
+		bool busy = column_is_busy(candidates[i].column);
+		column_unlock(candidates[i].x, candidates[i].z);
+		if (!busy) candidates[released_count++] = candidates[i];
+	}
+	if (!released_count) return;
+
+	pthread_mutex_lock(&retired_mutex);
+	for (int i = 0; i < released_count; i++) {
+		for (int j = 0; j < retired_count; j++) {
+			if (retired_columns[j].column == candidates[i].column) {
+				retired_columns[j] = retired_columns[--retired_count];
+				break;
+			}
+		}
+	}
+	pthread_mutex_unlock(&retired_mutex);
+
+	for (int i = 0; i < released_count; i++)
+		chunk_column_release(candidates[i].column);
+}
+
+// Generate all WORLD_HEIGHT chunks for the nearest queued column, light
+// them, then install. Terrain gen runs without any chunk lock held, which
+// allows true parallelism.
+static void generate_column_job(void* arg, int worker) {
+	(void)arg;
+	(void)worker;
+	pthread_mutex_lock(&column_load_queue.mutex);
+	// Fewer requests than jobs once some were cancelled.
+	if (column_load_queue.size == 0) {
+		pthread_mutex_unlock(&column_load_queue.mutex);
+		return;
+	}
+	column_load_request_t req = dequeue_column();
+	pthread_mutex_unlock(&column_load_queue.mutex);
+
+	// Skip columns the player has scrolled away from since enqueueing.
+	if (!is_chunk_in_bounds(req.cx, 0, req.cz)) {
+		finish_column_request(&req);
+		return;
+	}
+
+	// --- Load from disk, or generate (no locks held) ---
+	Chunk* column = chunk_column_acquire();
+	if (!column) {
+		fprintf(stderr, "Failed to allocate chunk column\n");
+		finish_column_request(&req);
+		return;
+	}
+	if (region_load_column(req.cx, req.cz, column)) {
+		// Saved columns already carry their light.
+		for (int cy = 0; cy < WORLD_HEIGHT; cy++) {
+			set_chunk_position(&column[cy], req.ci_x, cy, req.ci_z, req.cx, cy, req.cz);
+			column[cy].needs_update = !chunk_is_uniform(&column[cy], 0);
+		}
+		scan_column_sky(column);
+	} else {
+		column_context_t ctx;
 #ifdef DEBUG
 		profiler_start(PROFILER_ID_TERRAIN, false);
 #endif
+		generate_column_context(&ctx, req.cx, req.cz);
 		for (int cy = 0; cy < WORLD_HEIGHT; cy++) {
-			load_chunk_data(&temp_chunks[cy], req.ci_x, cy, req.ci_z, req.cx, cy, req.cz);
+			load_chunk_data(&column[cy], &ctx, req.ci_x, cy, req.ci_z, cy);
+			column[cy].dirty = true;
 		}
 #ifdef DEBUG
 		profiler_stop(PROFILER_ID_TERRAIN, false);
 #endif
 
-		// --- Sky lighting pass (outside chunks_mutex) ---
+		// --- Sky lighting pass ---
 #ifdef DEBUG
 		profiler_start(PROFILER_ID_LIGHTING, false);
 #endif
-		init_column_lighting(temp_chunks);
+		init_column_lighting(column, &ctx);
 #ifdef DEBUG
 		profiler_stop(PROFILER_ID_LIGHTING, false);
 #endif
+		release_column_context(&ctx);
+	}
 
-		// --- Install (under chunks_mutex) ---
-		pthread_mutex_lock(&chunks_mutex);
+	for (int cy = 0; cy < WORLD_HEIGHT; cy++)
+		column[cy].is_loaded = true;
 
-		// Re-validate after acquiring lock.
-		current_offset_x = (int)atomic_load(&world_offset_x);
-		current_offset_z = (int)atomic_load(&world_offset_z);
-		if (req.ci_x != req.cx - current_offset_x || req.ci_z != req.cz - current_offset_z) {
-			pthread_mutex_unlock(&chunks_mutex);
-			track_chunk_completed();
-			continue;
-		}
+	// --- Install (under the locks of the slot and its neighbours) ---
+	pthread_rwlock_rdlock(&chunk_window_lock);
 
-		for (int cy = 0; cy < WORLD_HEIGHT; cy++) {
-			Chunk *slot = &chunks[req.ci_x][cy][req.ci_z];
-			unload_chunk(slot);
-			*slot = temp_chunks[cy];
-			slot->is_loaded = true;
-		}
+	// Re-validate now that the window cannot move.
+	if (!is_chunk_in_bounds(req.cx, 0, req.cz)) {
+		pthread_rwlock_unlock(&chunk_window_lock);
+		chunk_column_release(column);
+		finish_column_request(&req);
+		return;
+	}
 
-		// Cross-boundary relight is handled by the mesh thread when it processes
-		// each chunk and checks are_all_neighbors_loaded + lighting_changed.
-		// Just mark horizontal neighbours for mesh rebuild since new faces appeared.
-		for (int cy = 0; cy < WORLD_HEIGHT; cy++) {
-			static const int8_t ndx[] = { 1,-1, 0, 0 };
-			static const int8_t ndz[] = { 0, 0, 1,-1 };
-			for (int d = 0; d < 4; d++) {
-				int nx = (int)req.ci_x + ndx[d];
-				int nz = (int)req.ci_z + ndz[d];
-				if (nx < 0 || nx >= settings.render_distance) continue;
-				if (nz < 0 || nz >= settings.render_distance) continue;
-				if (chunks[nx][cy][nz].is_loaded)
-					chunks[nx][cy][nz].needs_update = true;
-			}
+	column_area_t area;
+	column_lock_area(&area, req.ci_x, req.ci_z);
+	swap_column(req.ci_x, req.ci_z, column);
+
+	// Cross-boundary relight is handled by the mesh job when it processes
+	// each chunk and checks are_all_neighbors_loaded + lighting_changed.
+	// Just mark horizontal neighbours for mesh rebuild since new faces appeared.
+	static const int8_t ndx[] = { 1,-1, 0, 0 };
+	static const int8_t ndz[] = { 0, 0, 1,-1 };
+	for (int cy = 0; cy < WORLD_HEIGHT; cy++) {
+		for (int d = 0; d < 4; d++) {
+			Chunk *nc = get_chunk(req.cx + ndx[d], cy, req.cz + ndz[d]);
+			if (nc && nc->is_loaded)
+				nc->needs_update = true;
 		}
+	}
 
-		pthread_mutex_unlock(&chunks_mutex);
-		track_chunk_completed();
+	// Mesh the new column once the columns around it are in.
+	job_counter_t* deps[MESH_COLUMN_DEPS];
+	int dep_count = mesh_column_deps(req.cx, req.cz, deps);
+	for (int cy = 0; cy < WORLD_HEIGHT; cy++)
+		if (chunks[req.ci_x][cy][req.ci_z]->needs_update)
+			queue_chunk_mesh(req.ci_x, cy, req.ci_z, JOB_PRIORITY_NORMAL, deps, dep_count);
+
+	column_unlock_area(&area);
+	pthread_rwlock_unlock(&chunk_window_lock);
+	finish_column_request(&req);
+}
+
+// Queue the column in ring slot (x, z) for writing if any chunk in it is
+// dirty. Caller holds chunk_window_lock for writing.
+static void save_column(int x, int z) {
+	Chunk* column[WORLD_HEIGHT];
+	bool dirty = false;
+	for (int y = 0; y < WORLD_HEIGHT; y++) {
+		column[y] = chunks[x][y][z];
+		dirty |= column[y]->dirty;
 	}
-	return NULL;
+	if (!column[0]->is_loaded || !dirty) return;
+	region_save_column(column);
+	for (int y = 0; y < WORLD_HEIGHT; y++)
+		column[y]->dirty = false;
 }
 
-void start_world_gen_thread() {
+void start_world_gen() {
 	init_column_load_queue();
 	init_world_gen_tracker();
-	world_gen_thread_running = true;
-	for (int i = 0; i < NUM_GEN_THREADS; i++)
-		pthread_create(&world_gen_threads[i], NULL, world_gen_thread_func, NULL);
+	region_init(NULL);
 }
 
-void stop_world_gen_thread() {
-	world_gen_thread_running = false;
-	pthread_mutex_lock(&column_load_queue.mutex);
-	pthread_cond_broadcast(&column_load_queue.cond);
-	pthread_mutex_unlock(&column_load_queue.mutex);
-	for (int i = 0; i < NUM_GEN_THREADS; i++)
-		pthread_join(world_gen_threads[i], NULL);
+// Call after jobs_shutdown, so no column job is still running.
+void stop_world_gen() {
+	// Write back everything still loaded before the grid is freed.
+	pthread_rwlock_wrlock(&chunk_window_lock);
+	for (int x = 0; x < settings.render_distance; x++)
+		for (int z = 0; z < settings.render_distance; z++)
+			save_column(x, z);
+	pthread_rwlock_unlock(&chunk_window_lock);
+	region_shutdown();
+	structure_cache_clear();
+
+	// No mesh job is left to hold a retired column.
+	for (int i = 0; i < retired_count; i++)
+		chunk_column_release(retired_columns[i].column);
+	free(retired_columns);
+	retired_columns = NULL;
+	retired_count = 0;
+	retired_capacity = 0;
+
 	pthread_mutex_destroy(&column_load_queue.mutex);
-	pthread_cond_destroy(&column_load_queue.cond);
 	free(column_load_queue.requests);
 	column_load_queue.requests = NULL;
+	column_load_queue.size = 0;
+	for (size_t i = 0; i < cache_size; i++)
+		job_counter_destroy(&column_pending[i]);
 	free(chunk_needs_load_cache);
+	free(column_inflight);
+	free(column_pending);
 	chunk_needs_load_cache = NULL;
+	column_inflight = NULL;
+	column_pending = NULL;
 	cache_size = 0;
 }
 
+// is_loaded is atomic, so the main thread checks this without the column lock.
 static bool column_needs_loading(uint8_t ci_x, uint8_t ci_z) {
 	for (int cy = 0; cy < WORLD_HEIGHT; cy++) {
-		if (!chunks[ci_x][cy][ci_z].is_loaded)
+		if (!chunks[ci_x][cy][ci_z]->is_loaded)
 			return true;
 	}
 	return false;
 }
 
 void load_around_entity(Entity* entity) {
+	release_retired_columns();
+
 	int center_cx = floorf(entity->pos.x / CHUNK_SIZE) - (settings.render_distance / 2);
 	int center_cz = floorf(entity->pos.z / CHUNK_SIZE) - (settings.render_distance / 2);
 
@@ -268,7 +591,7 @@ void load_around_entity(Entity* entity) {
 
 	bool position_changed = (dx != 0 || dz != 0);
 	// Don't return early — always fall through to enqueue missing columns.
-	// This re-enqueues any jobs that were discarded due to stale-check.
+	// enqueue_column skips columns that are already queued or generating.
 
 #ifdef DEBUG
 	if (position_changed) {
@@ -281,84 +604,62 @@ void load_around_entity(Entity* entity) {
 	last_cz = center_cz;
 
 	if (position_changed) {
-	pthread_mutex_lock(&chunks_mutex);
+	// Moving the window remaps every slot, so it waits for workers to leave
+	// their column locks and keeps them out until it is done.
+	pthread_rwlock_wrlock(&chunk_window_lock);
 
-	// Unload columns that scroll off the edge.
+	// Ring slots are fixed per world column, so only columns that fall out
+	// of the new window are unloaded; everything else stays where it is.
+	atomic_store(&world_offset_x, center_cx);
+	atomic_store(&world_offset_z, center_cz);
 	for (int x = 0; x < settings.render_distance; x++) {
-		int new_x = x - dx;
-		int new_z_dummy = 0; // handled below
-		(void)new_z_dummy;
 		for (int z = 0; z < settings.render_distance; z++) {
-			int new_z = z - dz;
-			bool scrolls_off = (new_x < 0 || new_x >= settings.render_distance ||
-								new_z < 0 || new_z >= settings.render_distance);
-			if (scrolls_off) {
-				for (int y = 0; y < WORLD_HEIGHT; y++)
-					unload_chunk(&chunks[x][y][z]);
-			}
-		}
-	}
-
-	// Single-pass scratch-buffer shift — fixes diagonal move corruption in the
-	// original two-pass approach where X-shift would overwrite slots the Z-shift
-	// still needed to read.
-	{
-		int rd = settings.render_distance;
-		size_t total = (size_t)rd * WORLD_HEIGHT * rd;
-		Chunk *tmp = malloc(total * sizeof(Chunk));
-		if (tmp) {
-			memset(tmp, 0, total * sizeof(Chunk));
-			for (int x = 0; x < rd; x++) {
-				int nx = x - dx;
-				if (nx < 0 || nx >= rd) continue;
-				for (int z = 0; z < rd; z++) {
-					int nz = z - dz;
-					if (nz < 0 || nz >= rd) continue;
-					for (int y = 0; y < WORLD_HEIGHT; y++) {
-						tmp[(size_t)nx*WORLD_HEIGHT*rd + y*rd + nz] = chunks[x][y][z];
-						tmp[(size_t)nx*WORLD_HEIGHT*rd + y*rd + nz].ci_x = nx;
-						tmp[(size_t)nx*WORLD_HEIGHT*rd + y*rd + nz].ci_z = nz;
-						tmp[(size_t)nx*WORLD_HEIGHT*rd + y*rd + nz].mesh_dirty = true;
-					}
-				}
+			Chunk *column = chunks[x][0][z];
+			if (!column->is_loaded || is_chunk_in_bounds(column->x, 0, column->z)) continue;
+			save_column(x, z);
+			// A mesh job may still be building one of these chunks, so swap
+			// in an empty column rather than freeing them here.
+			Chunk *empty = chunk_column_acquire();
+			if (!empty) {
+				fprintf(stderr, "Failed to allocate chunk column\n");
+				continue;
 			}
-			memcpy(chunks[0][0], tmp, total * sizeof(Chunk));
-			free(tmp);
+			swap_column(x, z, empty);
 		}
 	}
-	// Update world_offset AFTER data is in place so get_block_at always
-	// sees a consistent (offset, data) pair.
-	atomic_store(&world_offset_x, center_cx);
-	atomic_store(&world_offset_z, center_cz);
 	mesh_needs_rebuild = true;
 
 	// Mark edge columns that now border empty slots for mesh rebuild.
 	// Only mark columns that are loaded and border an unloaded neighbour —
 	// do NOT mark surviving interior columns since their mesh is still valid.
+	static const int8_t ndx[] = { 1,-1, 0, 0 };
+	static const int8_t ndz[] = { 0, 0, 1,-1 };
 	for (int x = 0; x < settings.render_distance; x++) {
 		for (int z = 0; z < settings.render_distance; z++) {
-			if (!chunks[x][0][z].is_loaded) continue;
+			Chunk *column = chunks[x][0][z];
+			if (!column->is_loaded) continue;
 			bool borders_empty = false;
-			if (x > 0 && !chunks[x-1][0][z].is_loaded) borders_empty = true;
-			if (x < settings.render_distance-1 && !chunks[x+1][0][z].is_loaded) borders_empty = true;
-			if (z > 0 && !chunks[x][0][z-1].is_loaded) borders_empty = true;
-			if (z < settings.render_distance-1 && !chunks[x][0][z+1].is_loaded) borders_empty = true;
+			for (int d = 0; d < 4; d++) {
+				Chunk *nc = get_chunk(column->x + ndx[d], 0, column->z + ndz[d]);
+				if (nc && !nc->is_loaded) borders_empty = true;
+			}
 			if (borders_empty) {
 				for (int y = 0; y < WORLD_HEIGHT; y++)
-					chunks[x][y][z].needs_update = true;
+					chunks[x][y][z]->needs_update = true;
 			}
 		}
 	}
 
-	pthread_mutex_unlock(&chunks_mutex);
+	pthread_rwlock_unlock(&chunk_window_lock);
 	} // end position_changed shift block
 
 	float entity_chunk_x = entity->pos.x / CHUNK_SIZE;
 	float entity_chunk_z = entity->pos.z / CHUNK_SIZE;
+	if (position_changed)
+		reprioritize_columns(entity_chunk_x, entity_chunk_z);
 
 	// Count columns to load.
 	int cols_to_load = 0;
-	pthread_mutex_lock(&chunks_mutex);
 	for (uint8_t x = 0; x < settings.render_distance; x++) {
 		for (uint8_t z = 0; z < settings.render_distance; z++) {
 			size_t idx = (size_t)x * settings.render_distance + z;
@@ -366,7 +667,6 @@ void load_around_entity(Entity* entity) {
 			if (chunk_needs_load_cache[idx]) cols_to_load++;
 		}
 	}
-	pthread_mutex_unlock(&chunks_mutex);
 
 	if (cols_to_load == 0) {
 #ifdef DEBUG
@@ -380,12 +680,14 @@ void load_around_entity(Entity* entity) {
 			size_t idx = (size_t)x * settings.render_distance + z;
 			if (!chunk_needs_load_cache[idx]) continue;
 
-			float wdx = (x + center_cx) - entity_chunk_x;
-			float wdz = (z + center_cz) - entity_chunk_z;
+			int cx = slot_chunk_coord(x, center_cx);
+			int cz = slot_chunk_coord(z, center_cz);
+			float wdx = cx - entity_chunk_x;
+			float wdz = cz - entity_chunk_z;
 			float dist_sq = wdx*wdx + wdz*wdz;
 
-			enqueue_column(x, z, x + center_cx, z + center_cz, dist_sq);
-			track_chunk_queued();
+			if (enqueue_column(x, z, cx, cz, dist_sq))
+				track_chunk_queued();
 		}
 	}
 
@@ -398,31 +700,16 @@ void load_around_entity(Entity* entity) {
 	pthread_mutex_unlock(&world_gen_tracker.mutex);
 }
 
-void load_chunk_data(Chunk* chunk, unsigned char ci_x, unsigned char ci_y, unsigned char ci_z, int cx, int cy, int cz) {
-	chunk->ci_x = ci_x;
-	chunk->ci_y = ci_y;
-	chunk->ci_z = ci_z;
-	chunk->x = cx;
-	chunk->y = cy;
-	chunk->z = cz;
-	chunk->needs_update = true;
-	chunk->lighting_changed = true;
-
-	generate_chunk_terrain(chunk, cx, cy, cz);
+void load_chunk_data(Chunk* chunk, const column_context_t* ctx, unsigned char ci_x, unsigned char ci_y, unsigned char ci_z, int cy) {
+	set_chunk_position(chunk, ci_x, ci_y, ci_z, ctx->cx, cy, ctx->cz);
+	generate_chunk_terrain(chunk, ctx, cy);
+	chunk_compact(chunk);
+	chunk_update_summary(chunk);
 }
 
 void unload_chunk(Chunk* chunk) {
 	if (chunk == NULL) return;
 
-	for (uint8_t face = 0; face < 6; face++) {
-		free(chunk->faces[face].vertices);
-		free(chunk->faces[face].indices);
-		free(chunk->transparent_faces[face].vertices);
-		free(chunk->transparent_faces[face].indices);
-
-		chunk->faces[face].vertices = NULL;
-		chunk->faces[face].indices = NULL;
-		chunk->transparent_faces[face].vertices = NULL;
-		chunk->transparent_faces[face].indices = NULL;
-	}
+	chunk_free_storage(chunk);
+	chunk_mesh_free(&chunk->mesh);
 }
\ No newline at end of file
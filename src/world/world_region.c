@@ -0,0 +1,364 @@
+#include "world.h"
+#include "config.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// Region files hold REGION_SIZE x REGION_SIZE columns. The header is an
+// offset table with one entry per column; payloads are the column's
+// serialized chunks, run-length encoded. A rewritten column goes into the
+// first gap between live payloads that fits it, or after the last one, and
+// its entry is repointed once the payload is written. Its old payload then
+// becomes a gap for later writes, so the file stays close to its live size.
+#define REGION_SIZE 32
+#define REGION_COLUMNS (REGION_SIZE * REGION_SIZE)
+#define REGION_MAGIC "CCRG"
+#define REGION_VERSION 1
+#define CHUNK_SERIALIZED_MAX (5 + MAX_BLOCK_TYPES + 2 * CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE)
+#define COLUMN_SERIALIZED_MAX (WORLD_HEIGHT * CHUNK_SERIALIZED_MAX)
+
+typedef struct {
+	uint32_t offset;
+	uint32_t size;      // encoded payload bytes, 0 = column not stored
+	uint32_t raw_size;  // serialized bytes before encoding
+} region_entry_t;
+
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	region_entry_t entries[REGION_COLUMNS];
+} region_header_t;
+
+// Columns waiting to be written. Readers check this list before the file so
+// a column unloaded and reloaded before its write lands is not lost.
+typedef struct region_write {
+	int cx, cz;
+	uint8_t* data;
+	size_t size;
+	struct region_write* next;
+} region_write_t;
+
+static char region_dir[1024];
+static pthread_t region_thread;
+static pthread_mutex_t region_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t region_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t region_idle_cond = PTHREAD_COND_INITIALIZER;
+static region_write_t* write_head = NULL;
+static region_write_t* write_tail = NULL;
+static bool region_running = false;
+// Freed payloads get overwritten, so file reads must not overlap a write.
+static pthread_rwlock_t region_file_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static int floor_div(int a, int b) {
+	return (a < 0) ? ((a + 1) / b - 1) : (a / b);
+}
+
+static void region_path(char* out, size_t size, int cx, int cz) {
+	snprintf(out, size, "%s/r.%d.%d.bin", region_dir, floor_div(cx, REGION_SIZE), floor_div(cz, REGION_SIZE));
+}
+
+static int region_index(int cx, int cz) {
+	int lx = cx - floor_div(cx, REGION_SIZE) * REGION_SIZE;
+	int lz = cz - floor_div(cz, REGION_SIZE) * REGION_SIZE;
+	return lx * REGION_SIZE + lz;
+}
+
+// Control byte c < 128 is followed by c + 1 literal bytes; c >= 128 repeats
+// the next byte c - 126 times. Only runs of 3 or more are encoded as runs,
+// since they are the shortest a run record does not grow. Shorter runs stay
+// in the literal, so the output never exceeds REGION_RLE_BOUND(size).
+size_t region_rle_encode(const uint8_t* in, size_t size, uint8_t* out) {
+	size_t i = 0, o = 0;
+	while (i < size) {
+		size_t run = 1;
+		while (i + run < size && run < 129 && in[i + run] == in[i]) run++;
+		if (run >= 3) {
+			out[o++] = (uint8_t)(run + 126);
+			out[o++] = in[i];
+			i += run;
+			continue;
+		}
+		size_t start = i, len = 0;
+		while (i < size && len < 128) {
+			if (i + 2 < size && in[i + 1] == in[i] && in[i + 2] == in[i]) break;
+			i++;
+			len++;
+		}
+		out[o++] = (uint8_t)(len - 1);
+		memcpy(out + o, in + start, len);
+		o += len;
+	}
+	return o;
+}
+
+bool region_rle_decode(const uint8_t* in, size_t size, uint8_t* out, size_t out_size) {
+	size_t i = 0, o = 0;
+	while (i < size) {
+		uint8_t c = in[i++];
+		if (c < 128) {
+			size_t len = (size_t)c + 1;
+			if (i + len > size || o + len > out_size) return false;
+			memcpy(out + o, in + i, len);
+			i += len;
+			o += len;
+		} else {
+			size_t len = (size_t)c - 126;
+			if (i >= size || o + len > out_size) return false;
+			memset(out + o, in[i++], len);
+			o += len;
+		}
+	}
+	return o == out_size;
+}
+
+static bool deserialize_column(const uint8_t* data, size_t size, Chunk column[WORLD_HEIGHT]) {
+	size_t used = 0;
+	for (int cy = 0; cy < WORLD_HEIGHT; cy++) {
+		size_t n = chunk_deserialize(&column[cy], data + used, size - used);
+		if (!n) {
+			for (int i = 0; i < cy; i++)
+				chunk_free_storage(&column[i]);
+			return false;
+		}
+		used += n;
+	}
+	return true;
+}
+
+static int compare_entry_offset(const void* a, const void* b) {
+	uint32_t oa = ((const region_entry_t*)a)->offset;
+	uint32_t ob = ((const region_entry_t*)b)->offset;
+	return (oa > ob) - (oa < ob);
+}
+
+// First gap of at least size bytes between the live payloads, or past the
+// last one. The column being rewritten still counts as live, since its entry
+// points at the old payload until the new one is written.
+static uint32_t find_free_space(const region_header_t* header, uint32_t size) {
+	static region_entry_t live[REGION_COLUMNS];
+	int count = 0;
+	for (int i = 0; i < REGION_COLUMNS; i++)
+		if (header->entries[i].size)
+			live[count++] = header->entries[i];
+	qsort(live, count, sizeof(region_entry_t), compare_entry_offset);
+
+	uint32_t end = sizeof(region_header_t);
+	for (int i = 0; i < count; i++) {
+		if (live[i].offset >= end && live[i].offset - end >= size)
+			return end;
+		if (live[i].offset + live[i].size > end)
+			end = live[i].offset + live[i].size;
+	}
+	return end;
+}
+
+static bool write_column(const region_write_t* job) {
+	char path[1100];
+	region_path(path, sizeof(path), job->cx, job->cz);
+
+	// Only the I/O thread writes, so the header can live here between calls.
+	static region_header_t header;
+	FILE* f = fopen(path, "r+b");
+	if (f) {
+		if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, REGION_MAGIC, 4) != 0) {
+			fprintf(stderr, "Corrupt region header %s\n", path);
+			fclose(f);
+			return false;
+		}
+	} else {
+		f = fopen(path, "w+b");
+		if (!f) {
+			fprintf(stderr, "Failed to create region file %s: %s\n", path, strerror(errno));
+			return false;
+		}
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, REGION_MAGIC, 4);
+		header.version = REGION_VERSION;
+		if (fwrite(&header, sizeof(header), 1, f) != 1) {
+			fprintf(stderr, "Failed to write region header %s\n", path);
+			fclose(f);
+			return false;
+		}
+	}
+
+	uint8_t* encoded = malloc(REGION_RLE_BOUND(job->size));
+	if (!encoded) {
+		fclose(f);
+		return false;
+	}
+	size_t encoded_size = region_rle_encode(job->data, job->size, encoded);
+
+	int index = region_index(job->cx, job->cz);
+	region_entry_t entry = { find_free_space(&header, (uint32_t)encoded_size), (uint32_t)encoded_size, (uint32_t)job->size };
+	bool ok = fseek(f, entry.offset, SEEK_SET) == 0 && fwrite(encoded, encoded_size, 1, f) == 1;
+	free(encoded);
+
+	// Only repoint the entry once the payload is in the file.
+	if (ok) {
+		fseek(f, offsetof(region_header_t, entries) + index * sizeof(region_entry_t), SEEK_SET);
+		ok = fwrite(&entry, sizeof(entry), 1, f) == 1;
+	}
+	if (fclose(f) != 0) ok = false;
+	if (!ok) fprintf(stderr, "Failed to write column (%d, %d) to %s\n", job->cx, job->cz, path);
+	return ok;
+}
+
+static void* region_thread_func(void* arg) {
+	(void)arg;
+	pthread_mutex_lock(&region_mutex);
+	for (;;) {
+		while (!write_head && region_running)
+			pthread_cond_wait(&region_cond, &region_mutex);
+		if (!write_head) break;
+
+		// Leave the job queued while writing so readers still find it.
+		region_write_t* job = write_head;
+		pthread_mutex_unlock(&region_mutex);
+		pthread_rwlock_wrlock(&region_file_lock);
+		write_column(job);
+		pthread_rwlock_unlock(&region_file_lock);
+		pthread_mutex_lock(&region_mutex);
+
+		write_head = job->next;
+		if (!write_head) write_tail = NULL;
+		free(job->data);
+		free(job);
+		if (!write_head) pthread_cond_broadcast(&region_idle_cond);
+	}
+	pthread_mutex_unlock(&region_mutex);
+	return NULL;
+}
+
+// dir defaults to ~/.local/share/ccraft/world when NULL.
+bool region_init(const char* dir) {
+	if (dir) {
+		snprintf(region_dir, sizeof(region_dir), "%s", dir);
+	} else {
+		const char* home_path = getenv("HOME");
+		if (!home_path) {
+			fprintf(stderr, "HOME environment variable not set, world will not be saved\n");
+			return false;
+		}
+		char path[1024];
+		snprintf(path, sizeof(path), "%s/.local", home_path);
+		mkdir(path, 0755);
+		snprintf(path, sizeof(path), "%s/.local/share", home_path);
+		mkdir(path, 0755);
+		snprintf(path, sizeof(path), "%s/.local/share/ccraft", home_path);
+		mkdir(path, 0755);
+		snprintf(region_dir, sizeof(region_dir), "%s/.local/share/ccraft/world", home_path);
+	}
+	if (mkdir(region_dir, 0755) != 0 && errno != EEXIST) {
+		fprintf(stderr, "Failed to create world directory %s: %s\n", region_dir, strerror(errno));
+		return false;
+	}
+
+	region_running = true;
+	if (pthread_create(&region_thread, NULL, region_thread_func, NULL) != 0) {
+		fprintf(stderr, "Failed to start region I/O thread\n");
+		region_running = false;
+		return false;
+	}
+	return true;
+}
+
+// Blocks until every queued column has been written.
+void region_flush() {
+	pthread_mutex_lock(&region_mutex);
+	while (write_head)
+		pthread_cond_wait(&region_idle_cond, &region_mutex);
+	pthread_mutex_unlock(&region_mutex);
+}
+
+void region_shutdown() {
+	if (!region_running) return;
+	pthread_mutex_lock(&region_mutex);
+	region_running = false;
+	pthread_cond_signal(&region_cond);
+	pthread_mutex_unlock(&region_mutex);
+	pthread_join(region_thread, NULL);
+}
+
+// Serializes the column now and hands the write to the I/O thread.
+// Caller holds the column's lock or chunk_window_lock for writing.
+void region_save_column(Chunk* const column[WORLD_HEIGHT]) {
+	if (!region_running) return;
+
+	uint8_t* data = malloc(COLUMN_SERIALIZED_MAX);
+	region_write_t* job = malloc(sizeof(region_write_t));
+	if (!data || !job) {
+		fprintf(stderr, "Failed to allocate column save buffer\n");
+		free(data);
+		free(job);
+		return;
+	}
+	size_t size = 0;
+	for (int cy = 0; cy < WORLD_HEIGHT; cy++)
+		size += chunk_serialize(column[cy], data + size);
+
+	job->cx = column[0]->x;
+	job->cz = column[0]->z;
+	job->data = realloc(data, size);
+	if (!job->data) job->data = data;
+	job->size = size;
+	job->next = NULL;
+
+	pthread_mutex_lock(&region_mutex);
+	if (write_tail) write_tail->next = job;
+	else write_head = job;
+	write_tail = job;
+	pthread_cond_signal(&region_cond);
+	pthread_mutex_unlock(&region_mutex);
+}
+
+// Fills the storage of a zeroed column from a pending write or the region
+// file. Returns false if the column has never been saved.
+bool region_load_column(int cx, int cz, Chunk column[WORLD_HEIGHT]) {
+	if (!region_running) return false;
+
+	// Newest pending write for this column wins.
+	pthread_mutex_lock(&region_mutex);
+	const region_write_t* pending = NULL;
+	for (const region_write_t* job = write_head; job; job = job->next)
+		if (job->cx == cx && job->cz == cz) pending = job;
+	if (pending) {
+		bool ok = deserialize_column(pending->data, pending->size, column);
+		pthread_mutex_unlock(&region_mutex);
+		return ok;
+	}
+	pthread_mutex_unlock(&region_mutex);
+
+	char path[1100];
+	region_path(path, sizeof(path), cx, cz);
+	pthread_rwlock_rdlock(&region_file_lock);
+	FILE* f = fopen(path, "rb");
+	if (!f) {
+		pthread_rwlock_unlock(&region_file_lock);
+		return false;
+	}
+
+	region_entry_t entry;
+	fseek(f, offsetof(region_header_t, entries) + region_index(cx, cz) * sizeof(region_entry_t), SEEK_SET);
+	if (fread(&entry, sizeof(entry), 1, f) != 1 || entry.size == 0 || entry.raw_size > COLUMN_SERIALIZED_MAX) {
+		fclose(f);
+		pthread_rwlock_unlock(&region_file_lock);
+		return false;
+	}
+
+	uint8_t* encoded = malloc(entry.size);
+	uint8_t* data = malloc(entry.raw_size);
+	bool ok = encoded && data &&
+	          fseek(f, entry.offset, SEEK_SET) == 0 &&
+	          fread(encoded, entry.size, 1, f) == 1 &&
+	          region_rle_decode(encoded, entry.size, data, entry.raw_size) &&
+	          deserialize_column(data, entry.raw_size, column);
+	fclose(f);
+	pthread_rwlock_unlock(&region_file_lock);
+	free(encoded);
+	free(data);
+	if (!ok) fprintf(stderr, "Corrupt column (%d, %d) in %s, regenerating\n", cx, cz, path);
+	return ok;
+}
@@ -0,0 +1,297 @@
+#include "world.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHUNK_VOLUME (CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE)
+
+static inline int block_index(int x, int y, int z) {
+	return (x * CHUNK_SIZE + y) * CHUNK_SIZE + z;
+}
+
+static inline size_t indices_size(uint8_t bits) {
+	return (size_t)CHUNK_VOLUME * bits / 8;
+}
+
+static inline uint8_t read_index(const uint8_t* indices, uint8_t bits, int i) {
+	int bit = i * bits;
+	return (indices[bit >> 3] >> (bit & 7)) & ((1u << bits) - 1);
+}
+
+static inline void write_index(uint8_t* indices, uint8_t bits, int i, uint8_t value) {
+	int bit = i * bits;
+	uint8_t mask = ((1u << bits) - 1) << (bit & 7);
+	indices[bit >> 3] = (indices[bit >> 3] & ~mask) | ((value << (bit & 7)) & mask);
+}
+
+// Smallest index width that can address size palette entries.
+static uint8_t bits_for_palette(uint16_t size) {
+	if (size <= 1)  return 0;
+	if (size <= 2)  return 1;
+	if (size <= 4)  return 2;
+	if (size <= 16) return 4;
+	return 8;
+}
+
+static bool repack_indices(Chunk* chunk, uint8_t new_bits) {
+	uint8_t* repacked = NULL;
+	if (new_bits) {
+		repacked = calloc(indices_size(new_bits), 1);
+		if (!repacked) {
+			fprintf(stderr, "Failed to allocate chunk block indices\n");
+			return false;
+		}
+		if (chunk->palette_bits) {
+			for (int i = 0; i < CHUNK_VOLUME; i++)
+				write_index(repacked, new_bits, i, read_index(chunk->indices, chunk->palette_bits, i));
+		}
+	}
+	free(chunk->indices);
+	chunk->indices = repacked;
+	chunk->palette_bits = new_bits;
+	return true;
+}
+
+uint8_t chunk_get_id(const Chunk* chunk, int x, int y, int z) {
+	if (!chunk->palette_bits) return chunk->palette[0];
+	return chunk->palette[read_index(chunk->indices, chunk->palette_bits, block_index(x, y, z))];
+}
+
+void chunk_set_id(Chunk* chunk, int x, int y, int z, uint8_t id) {
+	// A zeroed chunk is uniform air with an implicit one-entry palette.
+	if (!chunk->palette_size) chunk->palette_size = 1;
+
+	uint16_t p = 0;
+	while (p < chunk->palette_size && chunk->palette[p] != id) p++;
+
+	if (p == chunk->palette_size) {
+		uint8_t bits = bits_for_palette(p + 1);
+		if (bits != chunk->palette_bits && !repack_indices(chunk, bits))
+			return;
+		chunk->palette[chunk->palette_size++] = id;
+	} else if (!chunk->palette_bits) {
+		return;  // uniform and already this id
+	}
+
+	write_index(chunk->indices, chunk->palette_bits, block_index(x, y, z), (uint8_t)p);
+}
+
+uint8_t chunk_get_light(const Chunk* chunk, int x, int y, int z) {
+	return chunk->light ? chunk->light[block_index(x, y, z)] : chunk->light_fill;
+}
+
+void chunk_set_light(Chunk* chunk, int x, int y, int z, uint8_t level) {
+	if (!chunk->light) {
+		if (level == chunk->light_fill) return;
+		uint8_t* light = malloc(CHUNK_VOLUME);
+		if (!light) {
+			fprintf(stderr, "Failed to allocate chunk light\n");
+			return;
+		}
+		memset(light, chunk->light_fill, CHUNK_VOLUME);
+		chunk->light = light;
+	}
+	chunk->light[block_index(x, y, z)] = level;
+}
+
+Block chunk_get_block(const Chunk* chunk, int x, int y, int z) {
+	return (Block){ chunk_get_id(chunk, x, y, z), chunk_get_light(chunk, x, y, z) };
+}
+
+void chunk_fill_light(Chunk* chunk, uint8_t level) {
+	free(chunk->light);
+	chunk->light = NULL;
+	chunk->light_fill = level;
+}
+
+bool chunk_is_uniform(const Chunk* chunk, uint8_t id) {
+	return !chunk->palette_bits && chunk->palette[0] == id;
+}
+
+void chunk_copy_ids(const Chunk* chunk, uint8_t out[CHUNK_SIZE][CHUNK_SIZE][CHUNK_SIZE]) {
+	uint8_t* dst = &out[0][0][0];
+	if (!chunk->palette_bits) {
+		memset(dst, chunk->palette[0], CHUNK_VOLUME);
+		return;
+	}
+	for (int i = 0; i < CHUNK_VOLUME; i++)
+		dst[i] = chunk->palette[read_index(chunk->indices, chunk->palette_bits, i)];
+}
+
+void chunk_copy_light(const Chunk* chunk, uint8_t out[CHUNK_SIZE][CHUNK_SIZE][CHUNK_SIZE]) {
+	if (chunk->light)
+		memcpy(&out[0][0][0], chunk->light, CHUNK_VOLUME);
+	else
+		memset(&out[0][0][0], chunk->light_fill, CHUNK_VOLUME);
+}
+
+// Drops palette entries no block uses any more and frees the light array
+// once it is uniform again. Installed chunks need their column locked.
+void chunk_compact(Chunk* chunk) {
+	if (chunk->palette_bits) {
+		bool used[MAX_BLOCK_TYPES] = {0};
+		for (int i = 0; i < CHUNK_VOLUME; i++)
+			used[read_index(chunk->indices, chunk->palette_bits, i)] = true;
+
+		uint8_t remap[MAX_BLOCK_TYPES], palette[MAX_BLOCK_TYPES];
+		uint16_t size = 0;
+		for (uint16_t p = 0; p < chunk->palette_size; p++) {
+			if (!used[p]) continue;
+			remap[p] = (uint8_t)size;
+			palette[size++] = chunk->palette[p];
+		}
+
+		uint8_t bits = bits_for_palette(size);
+		uint8_t* repacked = (size != chunk->palette_size && bits) ? calloc(indices_size(bits), 1) : NULL;
+		if (size != chunk->palette_size && (!bits || repacked)) {
+			for (int i = 0; bits && i < CHUNK_VOLUME; i++)
+				write_index(repacked, bits, i, remap[read_index(chunk->indices, chunk->palette_bits, i)]);
+			free(chunk->indices);
+			chunk->indices = repacked;
+			chunk->palette_bits = bits;
+			chunk->palette_size = size;
+			memcpy(chunk->palette, palette, size);
+		}
+	}
+
+	if (chunk->light) {
+		uint8_t first = chunk->light[0];
+		int i = 1;
+		while (i < CHUNK_VOLUME && chunk->light[i] == first) i++;
+		if (i == CHUNK_VOLUME) chunk_fill_light(chunk, first);
+	}
+}
+
+static inline bool summary_opaque(uint8_t id) {
+	return id != 0 && block_data[id][1] == 0;
+}
+
+static inline bool summary_cube(uint8_t id) {
+	return summary_opaque(id) && block_data[id][0] == BTYPE_REGULAR;
+}
+
+// Recomputes chunk->summary from the block ids. Call after generating,
+// loading or editing a chunk's blocks.
+void chunk_update_summary(Chunk* chunk) {
+	chunk_summary_t* s = &chunk->summary;
+	if (!chunk->palette_bits) {
+		uint8_t id = chunk->palette[0];
+		s->block_count  = id ? CHUNK_VOLUME : 0;
+		s->cube_count   = summary_cube(id) ? CHUNK_VOLUME : 0;
+		s->uniform      = true;
+		s->uniform_id   = id;
+		s->opaque_faces = summary_opaque(id) ? 0x3F : 0;
+		s->has_emitters = block_emission(id) != 0;
+		return;
+	}
+
+	uint8_t ids[CHUNK_SIZE][CHUNK_SIZE][CHUNK_SIZE];
+	chunk_copy_ids(chunk, ids);
+	const uint8_t* flat = &ids[0][0][0];
+	int count = 0, cubes = 0;
+	bool emitters = false;
+	for (int i = 0; i < CHUNK_VOLUME; i++) {
+		count += flat[i] != 0;
+		cubes += summary_cube(flat[i]);
+		emitters |= block_emission(flat[i]) != 0;
+	}
+
+	// Faces follow the mesher: 0 +z, 1 +x, 2 -z, 3 -x, 4 -y, 5 +y.
+	const int last = CHUNK_SIZE - 1;
+	uint8_t faces = 0x3F;
+	for (int a = 0; a < CHUNK_SIZE && faces; a++)
+		for (int b = 0; b < CHUNK_SIZE; b++) {
+			if (!summary_opaque(ids[a][b][last])) faces &= ~(1 << 0);
+			if (!summary_opaque(ids[last][a][b])) faces &= ~(1 << 1);
+			if (!summary_opaque(ids[a][b][0]))    faces &= ~(1 << 2);
+			if (!summary_opaque(ids[0][a][b]))    faces &= ~(1 << 3);
+			if (!summary_opaque(ids[a][0][b]))    faces &= ~(1 << 4);
+			if (!summary_opaque(ids[a][last][b])) faces &= ~(1 << 5);
+		}
+
+	s->block_count  = count;
+	s->cube_count   = cubes;
+	s->uniform      = false;
+	s->uniform_id   = 0;
+	s->opaque_faces = faces;
+	s->has_emitters = emitters;
+}
+
+void chunk_clear_light(Chunk* chunk) {
+	if (chunk->light)
+		memset(chunk->light, 0, CHUNK_VOLUME);
+	else
+		chunk->light_fill = 0;
+}
+
+void chunk_free_storage(Chunk* chunk) {
+	free(chunk->indices);
+	free(chunk->light);
+	chunk->indices = NULL;
+	chunk->light = NULL;
+	chunk->palette[0] = 0;
+	chunk->palette_size = 0;
+	chunk->palette_bits = 0;
+	chunk->light_fill = 0;
+	memset(&chunk->summary, 0, sizeof(chunk->summary));
+}
+
+size_t chunk_storage_bytes(const Chunk* chunk) {
+	return indices_size(chunk->palette_bits) + (chunk->light ? CHUNK_VOLUME : 0);
+}
+
+// Serialized layout: u16 palette_size, u8 palette_bits, u8 light_fill,
+// u8 has_light, palette, packed indices, then the light array if present.
+size_t chunk_serialize(const Chunk* chunk, uint8_t* out) {
+	uint16_t palette_size = chunk->palette_size ? chunk->palette_size : 1;
+	uint8_t* p = out;
+	memcpy(p, &palette_size, sizeof(palette_size)); p += sizeof(palette_size);
+	*p++ = chunk->palette_bits;
+	*p++ = chunk->light_fill;
+	*p++ = chunk->light != NULL;
+	memcpy(p, chunk->palette, palette_size); p += palette_size;
+	memcpy(p, chunk->indices, indices_size(chunk->palette_bits)); p += indices_size(chunk->palette_bits);
+	if (chunk->light) {
+		memcpy(p, chunk->light, CHUNK_VOLUME);
+		p += CHUNK_VOLUME;
+	}
+	return p - out;
+}
+
+// Fills a zeroed chunk's storage. Returns bytes consumed, or 0 if the data
+// is truncated or malformed.
+size_t chunk_deserialize(Chunk* chunk, const uint8_t* in, size_t size) {
+	const uint8_t* p = in;
+	const uint8_t* end = in + size;
+	uint16_t palette_size;
+	if (size < sizeof(palette_size) + 3) return 0;
+	memcpy(&palette_size, p, sizeof(palette_size)); p += sizeof(palette_size);
+	uint8_t bits = *p++;
+	uint8_t light_fill = *p++;
+	bool has_light = *p++;
+
+	if (palette_size == 0 || palette_size > MAX_BLOCK_TYPES || bits != bits_for_palette(palette_size))
+		return 0;
+	size_t needed = palette_size + indices_size(bits) + (has_light ? CHUNK_VOLUME : 0);
+	if ((size_t)(end - p) < needed) return 0;
+
+	uint8_t* indices = bits ? malloc(indices_size(bits)) : NULL;
+	uint8_t* light = has_light ? malloc(CHUNK_VOLUME) : NULL;
+	if ((bits && !indices) || (has_light && !light)) {
+		fprintf(stderr, "Failed to allocate chunk storage\n");
+		free(indices);
+		free(light);
+		return 0;
+	}
+
+	memcpy(chunk->palette, p, palette_size); p += palette_size;
+	if (bits) { memcpy(indices, p, indices_size(bits)); p += indices_size(bits); }
+	if (has_light) { memcpy(light, p, CHUNK_VOLUME); p += CHUNK_VOLUME; }
+	chunk->indices = indices;
+	chunk->light = light;
+	chunk->palette_size = palette_size;
+	chunk->palette_bits = bits;
+	chunk->light_fill = light_fill;
+	chunk_update_summary(chunk);
+	return p - in;
+}
@@ -1,5 +1,41 @@
 #include "world.h"
 #include "stb_perlin.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Structure placements are decided once per STRUCTURE_REGION_SIZE x
+// STRUCTURE_REGION_SIZE columns and every structure is clipped into per-chunk
+// cell lists right away, so generating a chunk only copies the cells that
+// land in it. Built regions live in a small refcounted cache shared by the
+// generation threads.
+#define STRUCTURE_REGION_SIZE 8
+#define STRUCTURE_REGION_COLUMNS (STRUCTURE_REGION_SIZE * STRUCTURE_REGION_SIZE)
+#define STRUCTURE_REGION_BUCKETS (STRUCTURE_REGION_COLUMNS * WORLD_HEIGHT)
+#define STRUCTURE_CACHE_SIZE 64
+#define TREE_GRID 8
+
+struct structure_region {
+	int rx, rz;
+	int refs;
+	bool cached;
+	uint64_t last_used;
+	structure_cell_t* cells;
+	// Bucket (column, cy) owns cells[start[b]] up to cells[start[b + 1]],
+	// b = (column_x * STRUCTURE_REGION_SIZE + column_z) * WORLD_HEIGHT + cy.
+	uint32_t start[STRUCTURE_REGION_BUCKETS + 1];
+};
+
+typedef struct {
+	const structure_t* structure;
+	int x, y, z;
+} structure_placement_t;
+
+static structure_region_t* structure_cache[STRUCTURE_CACHE_SIZE];
+static pthread_mutex_t structure_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t structure_cache_clock = 0;
+static const uint32_t no_structure_start[WORLD_HEIGHT + 1] = {0};
 
 structure_block_t tree_blocks[] = {
 	{0,0,0,17},{0,1,0,17},{0,2,0,17},{0,3,0,17},{0,4,0,17},
@@ -35,43 +71,203 @@ structure_t tree_structure = {
 
 bool can_place_tree(int world_x, int surface_y, int world_z, bool is_grass_surface) {
 	if (!is_grass_surface || surface_y <= SEA_LEVEL) return false;
-	int grid = 8;
-	if (((world_x % grid) + grid) % grid != 0) return false;
-	if (((world_z % grid) + grid) % grid != 0) return false;
+	if (((world_x % TREE_GRID) + TREE_GRID) % TREE_GRID != 0) return false;
+	if (((world_z % TREE_GRID) + TREE_GRID) % TREE_GRID != 0) return false;
 	float n = stb_perlin_noise3(world_x * structure_scale, 0.f, world_z * structure_scale, 0,0,0);
 	return n > 0.05f;
 }
 
-static void place_block(Chunk *chunk, int lx, int ly, int lz,
-                         uint8_t id, bool *empty) {
-	if (lx < 0 || lx >= CHUNK_SIZE || ly < 0 || ly >= CHUNK_SIZE || lz < 0 || lz >= CHUNK_SIZE)
-		return;
-	if (chunk->blocks[lx][ly][lz].id == 0) {
-		chunk->blocks[lx][ly][lz] = (Block){.id = id};
-		*empty = false;
+static int floor_div(int a, int b) {
+	return (a < 0) ? ((a + 1) / b - 1) : (a / b);
+}
+
+// Trees rooted on the tree grid whose footprint reaches into the area
+// starting at (x0, z0), in x-major order.
+static int place_trees(int x0, int z0, int span, structure_placement_t** out) {
+	int rw = tree_structure.width / 2, rd = tree_structure.depth / 2;
+	int gx0 = floor_div(x0 - rw, TREE_GRID) * TREE_GRID;
+	int gz0 = floor_div(z0 - rd, TREE_GRID) * TREE_GRID;
+	int nx  = (x0 + span - 1 + rw - gx0) / TREE_GRID + 1;
+	int nz  = (z0 + span - 1 + rd - gz0) / TREE_GRID + 1;
+	int n   = nx * nz;
+
+	float* buf = malloc(n * 7 * sizeof(float));
+	structure_placement_t* placements = malloc(n * sizeof(structure_placement_t));
+	if (!buf || !placements) {
+		free(buf);
+		free(placements);
+		return -1;
+	}
+	float *px = buf, *pz = buf + n, *sx = buf + 2 * n, *sz = buf + 3 * n;
+	float *cont = buf + 4 * n, *flat = buf + 5 * n, *mnt = buf + 6 * n;
+
+	// Surface height at every candidate, one noise batch per layer.
+	for (int i = 0; i < nx; i++)
+		for (int k = 0; k < nz; k++) {
+			px[i * nz + k] = (float)(gx0 + i * TREE_GRID);
+			pz[i * nz + k] = (float)(gz0 + k * TREE_GRID);
+		}
+	for (int j = 0; j < n; j++) { sx[j] = px[j] * continent_scale; sz[j] = pz[j] * continent_scale; }
+	perlin_noise2_batch(sx, sz, cont, n);
+	for (int j = 0; j < n; j++) { sx[j] = px[j] * flatness_scale; sz[j] = pz[j] * flatness_scale; }
+	perlin_noise2_batch(sx, sz, flat, n);
+	for (int j = 0; j < n; j++) { sx[j] = px[j] * mountain_scale; sz[j] = pz[j] * mountain_scale; }
+	perlin_noise2_batch(sx, sz, mnt, n);
+
+	int count = 0;
+	for (int j = 0; j < n; j++) {
+		int wx = (int)px[j], wz = (int)pz[j];
+		int sy = terrain_height(cont[j], flat[j], mnt[j]);
+		bool is_grass = sy > SEA_LEVEL && sy < SEA_LEVEL + 50;
+		if (!can_place_tree(wx, sy, wz, is_grass)) continue;
+		placements[count++] = (structure_placement_t){ &tree_structure, wx, sy + 1, wz };
+	}
+	free(buf);
+	*out = placements;
+	return count;
+}
+
+static structure_region_t* build_structure_region(int rx, int rz) {
+	int span = STRUCTURE_REGION_SIZE * CHUNK_SIZE;
+	int x0 = rx * span, z0 = rz * span;
+
+	structure_placement_t* placements;
+	int count = place_trees(x0, z0, span, &placements);
+	structure_region_t* r = calloc(1, sizeof(structure_region_t));
+	if (count < 0 || !r) {
+		if (count >= 0) free(placements);
+		free(r);
+		fprintf(stderr, "Failed to allocate structure region (%d, %d)\n", rx, rz);
+		return NULL;
 	}
+	r->rx = rx;
+	r->rz = rz;
+
+	// Count the cells of each (column, chunk) bucket, then fill them in
+	// placement order so overlapping structures resolve the same way as
+	// placing them one by one.
+	uint32_t fill[STRUCTURE_REGION_BUCKETS];
+	for (int pass = 0; pass < 2; pass++) {
+		for (int p = 0; p < count; p++) {
+			const structure_placement_t* pl = &placements[p];
+			for (int i = 0; i < pl->structure->block_count; i++) {
+				const structure_block_t* b = &pl->structure->blocks[i];
+				int lx = pl->x + b->x - x0;
+				int wy = pl->y + b->y;
+				int lz = pl->z + b->z - z0;
+				if (lx < 0 || lx >= span || lz < 0 || lz >= span || wy < 0 || wy >= WORLD_HEIGHT * CHUNK_SIZE)
+					continue;
+				int bucket = ((lx / CHUNK_SIZE) * STRUCTURE_REGION_SIZE + lz / CHUNK_SIZE) * WORLD_HEIGHT + wy / CHUNK_SIZE;
+				if (pass == 0) {
+					r->start[bucket + 1]++;
+					continue;
+				}
+				uint16_t pos = (uint16_t)((lx % CHUNK_SIZE) << 8 | (wy % CHUNK_SIZE) << 4 | (lz % CHUNK_SIZE));
+				r->cells[fill[bucket]++] = (structure_cell_t){ pos, b->block_id };
+			}
+		}
+		if (pass == 0) {
+			for (int b = 0; b < STRUCTURE_REGION_BUCKETS; b++)
+				r->start[b + 1] += r->start[b];
+			memcpy(fill, r->start, sizeof(fill));
+			r->cells = malloc((r->start[STRUCTURE_REGION_BUCKETS] + 1) * sizeof(structure_cell_t));
+			if (!r->cells) {
+				fprintf(stderr, "Failed to allocate structure region (%d, %d)\n", rx, rz);
+				free(placements);
+				free(r);
+				return NULL;
+			}
+		}
+	}
+	free(placements);
+	return r;
+}
+
+static void free_structure_region(structure_region_t* r) {
+	free(r->cells);
+	free(r);
+}
+
+// Caller holds structure_cache_mutex.
+static structure_region_t* find_cached_region(int rx, int rz) {
+	for (int i = 0; i < STRUCTURE_CACHE_SIZE; i++)
+		if (structure_cache[i] && structure_cache[i]->rx == rx && structure_cache[i]->rz == rz)
+			return structure_cache[i];
+	return NULL;
+}
+
+// Empty slot, else the least recently used region nobody holds, else -1.
+// Caller holds structure_cache_mutex.
+static int structure_cache_victim() {
+	int victim = -1;
+	for (int i = 0; i < STRUCTURE_CACHE_SIZE; i++) {
+		structure_region_t* c = structure_cache[i];
+		if (!c) return i;
+		if (!c->refs && (victim < 0 || c->last_used < structure_cache[victim]->last_used))
+			victim = i;
+	}
+	return victim;
+}
+
+// Returns the region holding column (cx, cz) with a reference taken, and
+// points cells/start at that column's buckets: chunk cy owns
+// cells[start[cy]] up to cells[start[cy + 1]]. On failure the column simply
+// gets no structures.
+structure_region_t* structure_acquire_column(int cx, int cz, const structure_cell_t** cells, const uint32_t** start) {
+	int rx = floor_div(cx, STRUCTURE_REGION_SIZE);
+	int rz = floor_div(cz, STRUCTURE_REGION_SIZE);
+
+	pthread_mutex_lock(&structure_cache_mutex);
+	structure_region_t* r = find_cached_region(rx, rz);
+	if (!r) {
+		// Build outside the lock; if another thread got there first its copy wins.
+		pthread_mutex_unlock(&structure_cache_mutex);
+		structure_region_t* built = build_structure_region(rx, rz);
+		if (!built) {
+			*cells = NULL;
+			*start = no_structure_start;
+			return NULL;
+		}
+		pthread_mutex_lock(&structure_cache_mutex);
+		r = find_cached_region(rx, rz);
+		if (r) {
+			free_structure_region(built);
+		} else {
+			r = built;
+			int victim = structure_cache_victim();
+			if (victim >= 0) {
+				if (structure_cache[victim]) free_structure_region(structure_cache[victim]);
+				structure_cache[victim] = r;
+				r->cached = true;
+			}
+		}
+	}
+	r->refs++;
+	r->last_used = ++structure_cache_clock;
+	pthread_mutex_unlock(&structure_cache_mutex);
+
+	int lx = cx - rx * STRUCTURE_REGION_SIZE;
+	int lz = cz - rz * STRUCTURE_REGION_SIZE;
+	*cells = r->cells;
+	*start = &r->start[(lx * STRUCTURE_REGION_SIZE + lz) * WORLD_HEIGHT];
+	return r;
+}
+
+void structure_release(structure_region_t* r) {
+	if (!r) return;
+	pthread_mutex_lock(&structure_cache_mutex);
+	// Regions built while every cache slot was in use are not cached.
+	if (--r->refs == 0 && !r->cached)
+		free_structure_region(r);
+	pthread_mutex_unlock(&structure_cache_mutex);
 }
 
-void generate_structure_in_chunk(Chunk *chunk, int chunk_x, int chunk_y, int chunk_z,
-                                 structure_t *s, int sx, int sy, int sz, bool *empty) {
-	int bx0 = chunk_x * CHUNK_SIZE;
-	int by0 = chunk_y * CHUNK_SIZE;
-	int bz0 = chunk_z * CHUNK_SIZE;
-
-	int smn_x = sx - s->width  / 2, smx_x = sx + s->width  / 2;
-	int smn_y = sy,                  smx_y = sy + s->height;
-	int smn_z = sz - s->depth  / 2, smx_z = sz + s->depth  / 2;
-
-	if (smx_x < bx0 || smn_x > bx0 + CHUNK_SIZE - 1 ||
-	    smx_y < by0 || smn_y > by0 + CHUNK_SIZE - 1 ||
-	    smx_z < bz0 || smn_z > bz0 + CHUNK_SIZE - 1) return;
-
-	for (int i = 0; i < s->block_count; i++) {
-		structure_block_t *b = &s->blocks[i];
-		place_block(chunk,
-		            sx + b->x - bx0,
-		            sy + b->y - by0,
-		            sz + b->z - bz0,
-		            b->block_id, empty);
+// Drops every cached region. No column may still hold one.
+void structure_cache_clear() {
+	pthread_mutex_lock(&structure_cache_mutex);
+	for (int i = 0; i < STRUCTURE_CACHE_SIZE; i++) {
+		if (structure_cache[i]) free_structure_region(structure_cache[i]);
+		structure_cache[i] = NULL;
 	}
+	pthread_mutex_unlock(&structure_cache_mutex);
 }
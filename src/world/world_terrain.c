@@ -3,7 +3,100 @@
 #include "stb_perlin.h"
 #include <math.h>
 
-void generate_chunk_terrain(Chunk *chunk, int chunk_x, int chunk_y, int chunk_z) {
+// Cave density lattice spacing in blocks; both must divide CHUNK_SIZE.
+#define CAVE_STEP_XZ 4
+#define CAVE_STEP_Y  4
+#define CAVE_LATTICE_XZ (CHUNK_SIZE / CAVE_STEP_XZ + 1)
+#define CAVE_LATTICE_Y  (CHUNK_SIZE / CAVE_STEP_Y + 1)
+
+// Surface y from the raw continent, flatness and mountain noise at a point.
+int terrain_height(float continent, float flatness, float mountain) {
+	float ch = ((continent + 1.f) * 0.5f - 0.5f) * 128.f;
+	float fn = powf((flatness + 1.f) * 0.5f, 2.f) * 20.f;
+	float mn = powf((mountain + 1.f) * 0.5f, 2.5f) * 64.f;
+	return (int)((ch + mn - fn) + (4 * CHUNK_SIZE));
+}
+
+// Heightmap, biome masks and structures for column (cx, cz). Every chunk of
+// the column reads these instead of re-running the 2D noise.
+void generate_column_context(column_context_t* ctx, int cx, int cz) {
+	ctx->cx = cx;
+	ctx->cz = cz;
+	ctx->structures = NULL;
+	ctx->structure_cells = NULL;
+	ctx->structure_start = NULL;
+
+	if (flat_world_gen) {
+		for (int x = 0; x < CHUNK_SIZE; x++) {
+			for (int z = 0; z < CHUNK_SIZE; z++) {
+				ctx->height[x][z]  = 4;
+				ctx->surface[x][z] = 4;
+				ctx->ocean[x][z]   = false;
+				ctx->beach[x][z]   = false;
+			}
+		}
+		ctx->min_height = ctx->max_height = 4;
+		return;
+	}
+
+	int world_x0 = cx * CHUNK_SIZE;
+	int world_z0 = cz * CHUNK_SIZE;
+	float cont[CHUNK_SIZE][CHUNK_SIZE];
+	float flat[CHUNK_SIZE][CHUNK_SIZE];
+	float mnt [CHUNK_SIZE][CHUNK_SIZE];
+
+	// The three 2D layers are evaluated for the whole column in one batch each.
+	float nx[3][CHUNK_SIZE * CHUNK_SIZE];
+	float nz[3][CHUNK_SIZE * CHUNK_SIZE];
+	for (int x = 0; x < CHUNK_SIZE; x++) {
+		float wx = world_x0 + x;
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			float wz = world_z0 + z;
+			int   i  = x * CHUNK_SIZE + z;
+			nx[0][i] = wx * continent_scale; nz[0][i] = wz * continent_scale;
+			nx[1][i] = wx * flatness_scale;  nz[1][i] = wz * flatness_scale;
+			nx[2][i] = wx * mountain_scale;  nz[2][i] = wz * mountain_scale;
+		}
+	}
+	perlin_noise2_batch(nx[0], nz[0], &cont[0][0], CHUNK_SIZE * CHUNK_SIZE);
+	perlin_noise2_batch(nx[1], nz[1], &flat[0][0], CHUNK_SIZE * CHUNK_SIZE);
+	perlin_noise2_batch(nx[2], nz[2], &mnt [0][0], CHUNK_SIZE * CHUNK_SIZE);
+
+	ctx->min_height = INT32_MAX;
+	ctx->max_height = INT32_MIN;
+	for (int x = 0; x < CHUNK_SIZE; x++) {
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			int h = terrain_height(cont[x][z], flat[x][z], mnt[x][z]);
+			ctx->height[x][z]  = h;
+			ctx->surface[x][z] = h > SEA_LEVEL ? h : SEA_LEVEL;
+			ctx->ocean[x][z]   = h < SEA_LEVEL;
+			ctx->beach[x][z]   = h >= SEA_LEVEL - 3 && h <= SEA_LEVEL + 2;
+			if (h < ctx->min_height) ctx->min_height = h;
+			if (h > ctx->max_height) ctx->max_height = h;
+		}
+	}
+
+	// Structures reaching into the column raise its surface where they stand.
+	ctx->structures = structure_acquire_column(cx, cz, &ctx->structure_cells, &ctx->structure_start);
+	for (int cy = 0; cy < WORLD_HEIGHT; cy++) {
+		for (uint32_t i = ctx->structure_start[cy]; i < ctx->structure_start[cy + 1]; i++) {
+			uint16_t pos = ctx->structure_cells[i].pos;
+			int x = pos >> 8, z = pos & 0xF;
+			int y = cy * CHUNK_SIZE + ((pos >> 4) & 0xF);
+			if (y > ctx->surface[x][z]) ctx->surface[x][z] = y;
+		}
+	}
+}
+
+void release_column_context(column_context_t* ctx) {
+	structure_release(ctx->structures);
+	ctx->structures = NULL;
+}
+
+// chunk must be freshly zeroed (uniform air); only non-air blocks are written.
+void generate_chunk_terrain(Chunk *chunk, const column_context_t* ctx, int chunk_y) {
+	int  chunk_x   = ctx->cx;
+	int  chunk_z   = ctx->cz;
 	int  base_y    = chunk_y * CHUNK_SIZE;
 	int  world_x0  = chunk_x * CHUNK_SIZE;
 	int  world_z0  = chunk_z * CHUNK_SIZE;
@@ -19,8 +112,10 @@ void generate_chunk_terrain(Chunk *chunk, int chunk_x, int chunk_y, int chunk_z)
 					else if (ay == 4)           id = 2;
 					else if (ay >= 4 - 2 && ay < 4) id = 1;
 					else if (ay > 0 && ay < 4 - 2)  id = 3;
-					chunk->blocks[x][y][z] = (Block){.id = id};
-					if (id) empty = false;
+					if (id) {
+						chunk_set_id(chunk, x, y, z, id);
+						empty = false;
+					}
 				}
 			}
 		}
@@ -28,88 +123,92 @@ void generate_chunk_terrain(Chunk *chunk, int chunk_x, int chunk_y, int chunk_z)
 		return;
 	}
 
-	static const int MAX_TERRAIN_HEIGHT = (int)(64 + 64 + 4 * CHUNK_SIZE);
-	if (base_y > MAX_TERRAIN_HEIGHT) {
-		chunk->needs_update = false;
-		return;
-	}
+	// Above both the highest surface and the sea only trees can reach.
+	if (base_y <= ctx->max_height || base_y <= SEA_LEVEL) {
+		// Cave density is sampled on a coarse world-aligned lattice and
+		// trilinearly interpolated. Lattice points on chunk borders are the
+		// same samples the neighbours use, so caves stay continuous. Only the
+		// layers up to the column's highest possible cave are sampled.
+		float density[CAVE_LATTICE_XZ][CAVE_LATTICE_XZ][CHUNK_SIZE];
+		int cave_top = ctx->max_height - 6 - base_y;
+		if (cave_top >= 0) {
+			if (cave_top > CHUNK_SIZE - 1) cave_top = CHUNK_SIZE - 1;
+			int layers = cave_top / CAVE_STEP_Y + 2;
 
-	float cont[CHUNK_SIZE][CHUNK_SIZE];
-	float flat[CHUNK_SIZE][CHUNK_SIZE];
-	float mnt [CHUNK_SIZE][CHUNK_SIZE];
-	float hmap[CHUNK_SIZE][CHUNK_SIZE];
-	bool  beach[CHUNK_SIZE][CHUNK_SIZE];
-	bool  ocean[CHUNK_SIZE][CHUNK_SIZE];
+			float lx[CAVE_LATTICE_XZ * CAVE_LATTICE_XZ * CAVE_LATTICE_Y];
+			float ly[CAVE_LATTICE_XZ * CAVE_LATTICE_XZ * CAVE_LATTICE_Y];
+			float lz[CAVE_LATTICE_XZ * CAVE_LATTICE_XZ * CAVE_LATTICE_Y];
+			float lv[CAVE_LATTICE_XZ * CAVE_LATTICE_XZ * CAVE_LATTICE_Y];
+			int n = 0;
+			for (int i = 0; i < CAVE_LATTICE_XZ; i++)
+				for (int k = 0; k < CAVE_LATTICE_XZ; k++)
+					for (int j = 0; j < layers; j++, n++) {
+						lx[n] = (float)(world_x0 + i * CAVE_STEP_XZ) * cave_scale;
+						ly[n] = (float)(base_y + j * CAVE_STEP_Y) * cave_scale;
+						lz[n] = (float)(world_z0 + k * CAVE_STEP_XZ) * cave_scale;
+					}
+			perlin_fbm_noise3_batch(lx, ly, lz, lv, n, 2.f, 0.5f, 2);
 
-	for (int x = 0; x < CHUNK_SIZE; x++) {
-		float wx = world_x0 + x;
-		for (int z = 0; z < CHUNK_SIZE; z++) {
-			float wz = world_z0 + z;
-			cont[x][z] = (stb_perlin_noise3(wx * continent_scale, 0.f, wz * continent_scale, 0,0,0) + 1.f) * 0.5f;
-			float ch   = (cont[x][z] - 0.5f) * 128.f;
-			flat[x][z] = powf((stb_perlin_noise3(wx * flatness_scale, 0.f, wz * flatness_scale, 0,0,0) + 1.f) * 0.5f, 2.f) * 20.f;
-			mnt [x][z] = powf((stb_perlin_noise3(wx * mountain_scale, 0.f, wz * mountain_scale, 0,0,0) + 1.f) * 0.5f, 2.5f) * 64.f;
-			hmap[x][z] = (ch + mnt[x][z] - flat[x][z]) + (4 * CHUNK_SIZE);
-			int h      = (int)hmap[x][z];
-			ocean[x][z]= h < SEA_LEVEL;
-			beach[x][z]= h >= SEA_LEVEL - 3 && h <= SEA_LEVEL + 2;
+			for (int i = 0; i < CAVE_LATTICE_XZ; i++)
+				for (int k = 0; k < CAVE_LATTICE_XZ; k++) {
+					const float* v = &lv[(i * CAVE_LATTICE_XZ + k) * layers];
+					for (int y = 0; y <= cave_top; y++) {
+						float t = (float)(y % CAVE_STEP_Y) / CAVE_STEP_Y;
+						density[i][k][y] = v[y / CAVE_STEP_Y] + (v[y / CAVE_STEP_Y + 1] - v[y / CAVE_STEP_Y]) * t;
+					}
+				}
 		}
-	}
 
-	for (int x = 0; x < CHUNK_SIZE; x++) {
-		float wx = world_x0 + x;
-		for (int z = 0; z < CHUNK_SIZE; z++) {
-			float wz   = world_z0 + z;
-			int   h    = (int)hmap[x][z];
-			bool  isb  = beach[x][z];
-			bool  iso  = ocean[x][z];
-			for (int y = 0; y < CHUNK_SIZE; y++) {
-				int ay = base_y + y;
-				bool cave = false;
-				if (ay < h - 5) {
-					float cv = stb_perlin_fbm_noise3(wx * cave_scale, ay * cave_scale, wz * cave_scale, 2.f, 0.5f, 2);
-					float df = powf(1.f - (float)ay / (float)h, 3.f);
-					cave     = cv > 0.3f - 0.15f * df;
-				}
-				uint8_t id = 0;
-				if (ay == 0) {
-					id = 7;
-				} else if (ay > h) {
-					id = ay <= SEA_LEVEL ? 9 : 0;
-				} else if (cave) {
-					id = 0;
-				} else if (ay == h) {
-					id = (isb || iso) ? 12 : 2;
-				} else if (ay >= h - 3) {
-					id = (isb || (iso && ay >= SEA_LEVEL - 3)) ? 12 : 1;
-				} else {
-					id = 3;
+		for (int x = 0; x < CHUNK_SIZE; x++) {
+			for (int z = 0; z < CHUNK_SIZE; z++) {
+				int   h    = ctx->height[x][z];
+				bool  isb  = ctx->beach[x][z];
+				bool  iso  = ctx->ocean[x][z];
+				for (int y = 0; y < CHUNK_SIZE; y++) {
+					int ay = base_y + y;
+					bool cave = false;
+					if (ay < h - 5) {
+						int   i  = x / CAVE_STEP_XZ, k = z / CAVE_STEP_XZ;
+						float tx = (float)(x % CAVE_STEP_XZ) / CAVE_STEP_XZ;
+						float tz = (float)(z % CAVE_STEP_XZ) / CAVE_STEP_XZ;
+						float c0 = density[i][k  ][y] + (density[i+1][k  ][y] - density[i][k  ][y]) * tx;
+						float c1 = density[i][k+1][y] + (density[i+1][k+1][y] - density[i][k+1][y]) * tx;
+						float cv = c0 + (c1 - c0) * tz;
+						// Interpolation flattens the density peaks; the lower threshold
+						// keeps the cave volume of the old per-block field (~21%).
+						float d  = 1.f - (float)ay / (float)h;
+						cave     = cv > 0.235f - 0.15f * d * d * d;
+					}
+					uint8_t id = 0;
+					if (ay == 0) {
+						id = 7;
+					} else if (ay > h) {
+						id = ay <= SEA_LEVEL ? 9 : 0;
+					} else if (cave) {
+						id = 0;
+					} else if (ay == h) {
+						id = (isb || iso) ? 12 : 2;
+					} else if (ay >= h - 3) {
+						id = (isb || (iso && ay >= SEA_LEVEL - 3)) ? 12 : 1;
+					} else {
+						id = 3;
+					}
+					if (id) {
+						chunk_set_id(chunk, x, y, z, id);
+						empty = false;
+					}
 				}
-				chunk->blocks[x][y][z] = (Block){.id = id};
-				if (id) empty = false;
 			}
 		}
 	}
 
-	int grid  = 8;
-	int sx_min = chunk_x * CHUNK_SIZE - tree_structure.width  / 2;
-	int sx_max = chunk_x * CHUNK_SIZE + CHUNK_SIZE - 1 + tree_structure.width  / 2;
-	int sz_min = chunk_z * CHUNK_SIZE - tree_structure.depth  / 2;
-	int sz_max = chunk_z * CHUNK_SIZE + CHUNK_SIZE - 1 + tree_structure.depth  / 2;
-	int gx0    = (int)floorf((float)sx_min / grid) * grid;
-	int gz0    = (int)floorf((float)sz_min / grid) * grid;
-
-	for (int swx = gx0; swx <= sx_max; swx += grid) {
-		for (int swz = gz0; swz <= sz_max; swz += grid) {
-			float cn = (stb_perlin_noise3(swx * continent_scale, 0.f, swz * continent_scale, 0,0,0) + 1.f) * 0.5f;
-			float ch = (cn - 0.5f) * 128.f;
-			float fn = powf((stb_perlin_noise3(swx * flatness_scale, 0.f, swz * flatness_scale, 0,0,0) + 1.f) * 0.5f, 2.f) * 20.f;
-			float mn = powf((stb_perlin_noise3(swx * mountain_scale, 0.f, swz * mountain_scale, 0,0,0) + 1.f) * 0.5f, 2.5f) * 64.f;
-			int   sy = (int)((ch + mn - fn) + 4 * CHUNK_SIZE);
-			bool  is_grass = sy > SEA_LEVEL && sy < SEA_LEVEL + 50;
-			if (can_place_tree(swx, sy, swz, is_grass))
-				generate_structure_in_chunk(chunk, chunk_x, chunk_y, chunk_z,
-				                            &tree_structure, swx, sy + 1, swz, &empty);
+	// Structures only fill air, in placement order.
+	for (uint32_t i = ctx->structure_start[chunk_y]; i < ctx->structure_start[chunk_y + 1]; i++) {
+		const structure_cell_t* cell = &ctx->structure_cells[i];
+		int x = cell->pos >> 8, y = (cell->pos >> 4) & 0xF, z = cell->pos & 0xF;
+		if (chunk_get_id(chunk, x, y, z) == 0) {
+			chunk_set_id(chunk, x, y, z, cell->id);
+			empty = false;
 		}
 	}
 